@@ -2,12 +2,26 @@
 #define __AVL_TREE_H__
 
 #include <utility>
+#include <span>
+#include <algorithm>
 #include <functional>
 #include <stack>
 #include <cassert>
 #include <cstdint>
-
-template <typename T, typename Compare = std::less<T>>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <limits>
+
+#include "../Common/node_pool.h"
+#include "../Common/compare.h"
+#include "../Common/memory_usage.h"
+#include "../Common/instrumentation.h"
+#include "../Common/prefetch.h"
+#include "../Common/node_layout.h"
+#include <bit>
+
+template <typename T, typename Compare = std::less<T>, typename Alloc = NodePool<T>, typename Stats = NoStats, typename Layout = PlainLayout>
 class AVLTree
 {
 public:
@@ -15,7 +29,7 @@ public:
     AVLTree() : node(nullptr) {}
     AVLTree(const T &val)
     {
-        node = new TreeNode(val);
+        node = create_node(val);
     }
 
     // Destructor
@@ -25,16 +39,19 @@ public:
     }
 
     // Copy
-    AVLTree(const AVLTree &other)
+    AVLTree(const AVLTree &other) : alloc(NodeTraits::select_on_container_copy_construction(other.alloc))
     {
-        auto copy = [](auto copy, const TreeNode *root) -> TreeNode *
+        auto copy = [this](auto copy, const TreeNode *root) -> TreeNode *
         {
             if (root == nullptr)
                 return nullptr;
-            TreeNode *ret = new TreeNode(root->val);
-            ret->height = root->height;
-            ret->left = copy(copy, root->left);
-            ret->right = copy(copy, root->right);
+            TreeNode *ret = create_node(root->val);
+            if constexpr (PACKED)
+                ret->set_balance(root->balance());
+            else
+                ret->height = root->height;
+            ret->set_left(copy(copy, root->left()));
+            ret->set_right(copy(copy, root->right()));
             return ret;
         };
         node = copy(copy, other.node);
@@ -49,11 +66,12 @@ public:
         AVLTree new_tree(other);
         std::swap(node, new_tree.node);
         std::swap(less_than, new_tree.less_than);
+        std::swap(alloc, new_tree.alloc);
         return *this;
     }
 
     // Move
-    AVLTree(AVLTree &&other) noexcept : node(other.node), less_than(std::move(other.less_than))
+    AVLTree(AVLTree &&other) noexcept : node(other.node), less_than(std::move(other.less_than)), alloc(std::move(other.alloc))
     {
         other.node = nullptr;
     }
@@ -66,21 +84,61 @@ public:
         clear(node);
         node = other.node;
         less_than = std::move(other.less_than);
+        alloc = std::move(other.alloc);
         other.node = nullptr;
         return *this;
     }
 
+    // Bulk load from a sorted, duplicate-free range in O(n) - middle elements become subtree roots
+    // A subtree of k nodes comes out bit_width(k) high, which gives the packed layout its balance factors
+    template <std::forward_iterator It>
+    static AVLTree from_sorted(It first, It last)
+    {
+        AVLTree tree;
+        auto build = [&](auto build, std::size_t n) -> TreeNode *
+        {
+            if (n == 0)
+                return nullptr;
+
+            TreeNode *left = build(build, (n - 1) / 2);
+            TreeNode *ret = tree.create_node(*first);
+            ++first;
+            ret->set_left(left);
+            ret->set_right(build(build, n - 1 - (n - 1) / 2));
+            if constexpr (PACKED)
+                ret->set_balance(std::bit_width(n - 1 - (n - 1) / 2) - std::bit_width((n - 1) / 2));
+            else
+                tree.update_height(ret);
+            return ret;
+        };
+
+        tree.node = build(build, std::distance(first, last));
+        return tree;
+    }
+
     // Search
-    bool find(const T &val)
+    bool find(const T &val) const
     {
-        TreeNode *root = node;
-        for (; root && root->val != val; root = less_than(val, root->val) ? root->left : root->right)
-            ;
+        for (TreeNode *root = node; root;)
+        {
+            std::weak_ordering cmp = compare(val, root);
+            if (cmp == 0)
+                return true;
+            root = root->next(cmp);
+        }
 
-        if (root == nullptr)
-            return false;
+        return false;
+    }
 
-        return true;
+    // Batched search - out[i] = find(keys[i]), FIND_BATCH_GROUP descents at a time in lockstep (run_lockstep)
+    void find_batch(std::span<const T> keys, std::span<bool> out) const
+    {
+        run_lockstep(keys, out, static_cast<const TreeNode *>(node), [this](const T &val, const TreeNode *root, bool &found) -> const TreeNode *
+        {
+            std::weak_ordering cmp = compare(val, root);
+            found = cmp == 0;
+            return root->next(cmp);
+        });
     }
 
     // Insert
@@ -88,48 +146,31 @@ public:
     {
         if (node == nullptr)
         {
-            node = new TreeNode(val);
+            node = create_node(val);
             return true;
         }
 
         TreeNode *root = node;
-        std::stack<TreeNode *> st;
-        for (; root && root->val != val; root = less_than(val, root->val) ? root->left : root->right)
-            st.push(root);
+        TreeNode *path[MAX_HEIGHT];
+        int depth = 0;
+        std::weak_ordering cmp = std::weak_ordering::equivalent;
+        for (; root && (cmp = compare(val, root)) != 0; root = root->next(cmp))
+            path[depth++] = root;
 
         if (root != nullptr)
             return false;
 
-        root = st.top();
-        st.pop();
-        TreeNode *ins_node = new TreeNode(val);
-        if (less_than(val, root->val))
-            root->left = ins_node;
+        root = path[depth - 1];
+        TreeNode *ins_node = create_node(val);
+        if (cmp < 0)
+            root->set_left(ins_node);
         else
-            root->right = ins_node;
-
-        do
-        {
-            if (st.empty())
-            {
-                node = balance(root);
-                root = nullptr;
-            }
-
-            else
-            {
-                TreeNode *n_root = st.top();
-
-                if (n_root->left == root)
-                    n_root->left = balance(root);
-                else
-                    n_root->right = balance(root);
-
-                st.pop();
-                root = n_root;
-            }
-        } while (root);
+            root->set_right(ins_node);
 
+        if constexpr (PACKED)
+            retrace_grown(path, depth, ins_node);
+        else
+            retrace(path, depth);
         return true;
     }
 
@@ -137,201 +178,300 @@ public:
     bool remove(const T &val)
     {
         TreeNode *root = node;
-        std::stack<TreeNode *> st;
-        for (; root && root->val != val; root = less_than(val, root->val) ? root->left : root->right)
-            st.push(root);
+        TreeNode *path[MAX_HEIGHT];
+        int depth = 0;
+        std::weak_ordering cmp = std::weak_ordering::equivalent;
+        for (; root && (cmp = compare(val, root)) != 0; root = root->next(cmp))
+            path[depth++] = root;
 
         if (root == nullptr)
             return false;
 
-        if (root->left == nullptr && root->right == nullptr)
+        int shrunk; // The side of path[depth - 1] that lost a node
+        if (root->left() == nullptr || root->right() == nullptr)
         {
-            if (st.empty())
+            // Splice out - at most one child takes the node's place
+            TreeNode *child = root->left() ? root->left() : root->right();
+            root->set_left(nullptr);
+            root->set_right(nullptr);
+
+            if (depth == 0)
             {
-                delete node;
-                node = nullptr;
+                destroy_node(root);
+                node = child;
                 return true;
             }
 
+            TreeNode *top = path[depth - 1];
+            shrunk = top->left() == root ? -1 : 1;
+            if (shrunk < 0)
+                top->set_left(child);
             else
-            {
-                TreeNode *top = st.top();
+                top->set_right(child);
 
-                if (top->left == root)
-                    top->left = nullptr;
-                else
-                    top->right = nullptr;
-
-                delete root;
-            }
+            destroy_node(root);
         }
 
-        else if (root->left == nullptr)
+        else
         {
-            if (st.empty())
-            {
-                node = root->right;
-                root->right = nullptr;
-                delete root;
-                return true;
-            }
+            TreeNode *in_ord_suc = root->right();
+            path[depth++] = root;
+            for (; in_ord_suc->left(); in_ord_suc = in_ord_suc->left())
+                path[depth++] = in_ord_suc;
 
+            std::swap(root->val, in_ord_suc->val);
+            root = path[depth - 1];
+            shrunk = root->left() == in_ord_suc ? -1 : 1;
+            if (shrunk < 0)
+                root->set_left(in_ord_suc->right());
             else
-            {
-                TreeNode *top = st.top();
+                root->set_right(in_ord_suc->right());
+            in_ord_suc->set_right(nullptr);
+            destroy_node(in_ord_suc);
+        }
 
-                if (top->left == root)
-                    top->left = root->right;
-                else
-                    top->right = root->right;
+        if constexpr (PACKED)
+            retrace_shrunk(path, depth, shrunk);
+        else
+            retrace(path, depth);
+        return true;
+    }
 
-                root->right = nullptr;
-                delete root;
-            }
-        }
+    void clear()
+    {
+        clear(node);
+        node = nullptr;
+    }
 
-        else if (root->right == nullptr)
-        {
-            if (st.empty())
-            {
-                node = root->left;
-                root->left = nullptr;
-                delete root;
-                return true;
-            }
+    // Node counts and bytes held by nodes - one key per node, so fill is always 1
+    MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage;
+        if constexpr (reserving_allocator<NodeAlloc>)
+            usage.reserved = alloc.reserved();
+        if (node == nullptr)
+            return usage;
 
+        std::stack<const TreeNode *> st;
+        st.push(node);
+
+        while (!st.empty())
+        {
+            const TreeNode *top = st.top();
+            st.pop();
+
+            usage.nodes++;
+            if (top->left())
+                st.push(top->left());
+            if (top->right())
+                st.push(top->right());
+            if (top->left() || top->right())
+                usage.internals++;
             else
-            {
-                TreeNode *top = st.top();
+                usage.leaves++;
+        }
 
-                if (top->left == root)
-                    top->left = root->left;
-                else
-                    top->right = root->left;
+        usage.keys = usage.nodes;
+        usage.bytes = usage.nodes * sizeof(TreeNode);
+        usage.fill = 1;
+        return usage;
+    }
 
-                root->left = nullptr;
-                delete root;
-            }
+    // Instrumentation counters - all zero-cost no-ops unless the tree was instantiated with a counting policy
+    const Stats &stats() const { return counters; }
+    void reset_stats() { counters.reset(); }
+
+private: // Members
+    // AVL height is below 1.4405 * log2(n + 2), so a descent path of this length covers any size_t count
+    static constexpr int MAX_HEIGHT = static_cast<int>(1.4405 * std::numeric_limits<std::size_t>::digits) + 1;
+
+    static constexpr bool PACKED = Layout::PACKED;
+    struct NoHeight
+    {
+    };
+
+    // Packed, the node keeps its balance factor (right height - left height, -1 to 1) instead of its height,
+    // one bit in each child pointer - the low bit of left is set when the left side is taller, the low bit
+    // of right when the right side is. A search picks its link first and masks it after (next), so the
+    // choice stays a conditional move rather than a branch per level
+    struct TreeNode
+    {
+        T val;
+        std::conditional_t<PACKED, TaggedPtr<TreeNode, 1>, TreeNode *> left_link, right_link;
+        [[no_unique_address]] std::conditional_t<PACKED, NoHeight, uint32_t> height;
+
+        TreeNode() : val(), left_link(nullptr), right_link(nullptr)
+        {
+            if constexpr (!PACKED)
+                height = 1;
         }
 
-        else
+        TreeNode(const T &val) : val(val), left_link(nullptr), right_link(nullptr)
         {
-            TreeNode *in_ord_suc = root->right;
-            st.push(root);
-            for (; in_ord_suc->left; in_ord_suc = in_ord_suc->left)
-                st.push(in_ord_suc);
+            if constexpr (!PACKED)
+                height = 1;
+        }
 
-            std::swap(root->val, in_ord_suc->val);
-            root = st.top();
-            if (root->left == in_ord_suc)
-                root->left = in_ord_suc->right;
+        TreeNode *left() const
+        {
+            if constexpr (PACKED)
+                return left_link.ptr();
             else
-                root->right = in_ord_suc->right;
-            in_ord_suc->right = nullptr;
-            delete in_ord_suc;
+                return left_link;
         }
 
-        root = st.top();
-        st.pop();
-
-        do
+        TreeNode *right() const
         {
-            if (st.empty())
-            {
-                node = balance(root);
-                root = nullptr;
-            }
-
+            if constexpr (PACKED)
+                return right_link.ptr();
             else
-            {
-                TreeNode *n_root = st.top();
-
-                if (n_root->left == root)
-                    n_root->left = balance(root);
-                else
-                    n_root->right = balance(root);
-
-                st.pop();
-                root = n_root;
-            }
-        } while (root);
+                return right_link;
+        }
 
-        return true;
-    }
+        // The child a search goes to from here, given how its key compared with val - picks the link before
+        // masking it, so the choice stays a conditional move
+        TreeNode *next(std::weak_ordering cmp) const
+        {
+            if constexpr (PACKED)
+                return (cmp < 0 ? left_link : right_link).ptr();
+            else
+                return cmp < 0 ? left_link : right_link;
+        }
 
-    void clear()
-    {
-        clear(node);
-        node = nullptr;
-    }
+        void set_left(TreeNode *left)
+        {
+            if constexpr (PACKED)
+                left_link.set_ptr(left);
+            else
+                left_link = left;
+        }
 
-private: // Members
-    struct TreeNode
-    {
-        T val;
-        TreeNode *left, *right;
-        uint32_t height;
+        void set_right(TreeNode *right)
+        {
+            if constexpr (PACKED)
+                right_link.set_ptr(right);
+            else
+                right_link = right;
+        }
 
-        TreeNode() : val(), height(1)
+        int balance() const
+            requires PACKED
         {
-            left = nullptr;
-            right = nullptr;
+            return static_cast<int>(right_link.tag()) - static_cast<int>(left_link.tag());
         }
 
-        TreeNode(const T &val) : val(val), height(1)
+        void set_balance(int balance)
+            requires PACKED
         {
-            left = nullptr;
-            right = nullptr;
+            left_link.set_tag(balance < 0);
+            right_link.set_tag(balance > 0);
         }
     };
 
     TreeNode *node;
     Compare less_than;
 
+    using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<TreeNode>;
+    using NodeTraits = std::allocator_traits<NodeAlloc>;
+    NodeAlloc alloc;
+    [[no_unique_address]] mutable Stats counters;
+
 private: // Functions
+    // Compares val against a node on the way down - where visits and comparisons are counted
+    std::weak_ordering compare(const T &val, const TreeNode *n) const
+    {
+        counters.visit();
+        counters.comparison();
+        return three_way(less_than, val, n->val);
+    }
+
+    template <typename... Args>
+    TreeNode *create_node(Args &&...args)
+    {
+        TreeNode *ret = NodeTraits::allocate(alloc, 1);
+        NodeTraits::construct(alloc, ret, std::forward<Args>(args)...);
+        return ret;
+    }
+
+    void destroy_node(TreeNode *node)
+    {
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
+    }
+
     void clear(TreeNode *node)
     {
         if (node == nullptr)
             return;
 
+        // Pooled nodes with nothing to destruct are dropped a slab at a time - no traversal
+        if constexpr (releasable_allocator<NodeAlloc> && std::is_trivially_destructible_v<TreeNode>)
+        {
+            alloc.release();
+            return;
+        }
+
         std::stack<TreeNode *> st;
         st.push(node);
 
         while (!st.empty())
         {
             TreeNode *top = st.top();
-            if (top->left || top->right)
+            if (top->left() || top->right())
             {
-                if (top->left)
+                if (top->left())
                 {
-                    st.push(top->left);
-                    top->left = nullptr;
+                    st.push(top->left());
+                    top->set_left(nullptr);
                 }
 
-                if (top->right)
+                if (top->right())
                 {
-                    st.push(top->right);
-                    top->right = nullptr;
+                    st.push(top->right());
+                    top->set_right(nullptr);
                 }
             }
 
             else
             {
-                delete top;
+                destroy_node(top);
                 st.pop();
             }
         }
     }
 
+    // Rebalances the ancestors on path bottom-up - stops as soon as a subtree comes out of balance()
+    // with its old height, since nothing above it can have changed
+    void retrace(TreeNode **path, int depth)
+    {
+        while (depth > 0)
+        {
+            TreeNode *root = path[--depth];
+            uint32_t old_height = root->height;
+            TreeNode *new_root = balance(root);
+
+            if (depth == 0)
+                node = new_root;
+            else if (path[depth - 1]->left() == root)
+                path[depth - 1]->set_left(new_root);
+            else
+                path[depth - 1]->set_right(new_root);
+
+            if (new_root->height == old_height)
+                return;
+        }
+    }
+
     void update_height(TreeNode *node)
     {
-        node->height = std::max(node->left ? node->left->height : 0, node->right ? node->right->height : 0) + 1;
+        node->height = std::max(node->left() ? node->left()->height : 0, node->right() ? node->right()->height : 0) + 1;
     }
 
     TreeNode *left_rotate(TreeNode *l, TreeNode *r)
     {
-        l->right = r->left;
-        r->left = l;
+        counters.rotation();
+        l->set_right(r->left());
+        r->set_left(l);
         update_height(l);
         update_height(r);
         return r;
@@ -339,43 +479,162 @@ private: // Functions
 
     TreeNode *right_rotate(TreeNode *r, TreeNode *l)
     {
-        r->left = l->right;
-        l->right = r;
+        counters.rotation();
+        r->set_left(l->right());
+        l->set_right(r);
         update_height(r);
         update_height(l);
         return l;
     }
 
+    // Packed rebalancing - AVL retracing on balance factors. Sides are -1 (left) and 1 (right), the sign of
+    // the balance factor a subtree leaning that way has
+
+    static TreeNode *child(const TreeNode *node, int side)
+    {
+        return side < 0 ? node->left() : node->right();
+    }
+
+    static void set_child(TreeNode *node, int side, TreeNode *child)
+    {
+        if (side < 0)
+            node->set_left(child);
+        else
+            node->set_right(child);
+    }
+
+    // Hangs new_root where old_root was - path[depth - 1] is old_root's parent
+    void relink(TreeNode **path, int depth, TreeNode *old_root, TreeNode *new_root)
+    {
+        if (depth == 0)
+            node = new_root;
+        else
+            set_child(path[depth - 1], path[depth - 1]->left() == old_root ? -1 : 1, new_root);
+    }
+
+    // Lifts root's child on side over it - balance factors are the caller's job
+    TreeNode *rotate_up(TreeNode *root, int side)
+    {
+        counters.rotation();
+        TreeNode *top = child(root, side);
+        set_child(root, side, child(top, -side));
+        set_child(top, -side, root);
+        return top;
+    }
+
+    // root is two levels taller on side - returns the new subtree root, and whether the subtree kept the
+    // height it had before the update (which only a delete can leave it with)
+    TreeNode *rebalance(TreeNode *root, int side, bool &height_kept)
+    {
+        TreeNode *top = child(root, side);
+        int top_balance = top->balance();
+
+        // Double rotate
+        if (top_balance == -side)
+        {
+            TreeNode *mid = child(top, -side);
+            int mid_balance = mid->balance();
+            set_child(root, side, rotate_up(top, -side));
+            rotate_up(root, side);
+            root->set_balance(mid_balance == side ? -side : 0);
+            top->set_balance(mid_balance == -side ? side : 0);
+            mid->set_balance(0);
+            height_kept = false;
+            return mid;
+        }
+
+        rotate_up(root, side);
+        height_kept = top_balance == 0;
+        root->set_balance(height_kept ? side : 0);
+        top->set_balance(height_kept ? -side : 0);
+        return top;
+    }
+
+    // After an insert below path[depth - 1] made grown one level taller
+    void retrace_grown(TreeNode **path, int depth, TreeNode *grown)
+    {
+        while (depth > 0)
+        {
+            TreeNode *root = path[--depth];
+            int side = root->left() == grown ? -1 : 1;
+
+            if (root->balance() == -side)
+            {
+                root->set_balance(0);
+                return;
+            }
+
+            if (root->balance() == 0)
+            {
+                root->set_balance(side);
+                grown = root;
+                continue;
+            }
+
+            // An insert rebalance always restores the old height
+            bool height_kept;
+            relink(path, depth, root, rebalance(root, side, height_kept));
+            return;
+        }
+    }
+
+    // After a delete made path[depth - 1]'s subtree on side one level shorter
+    void retrace_shrunk(TreeNode **path, int depth, int side)
+    {
+        while (depth > 0)
+        {
+            TreeNode *root = path[--depth];
+            int parent_side = depth > 0 && path[depth - 1]->left() == root ? -1 : 1;
+
+            if (root->balance() == 0)
+            {
+                root->set_balance(-side);
+                return;
+            }
+
+            if (root->balance() == side)
+                root->set_balance(0);
+            else
+            {
+                bool height_kept;
+                relink(path, depth, root, rebalance(root, -side, height_kept));
+                if (height_kept)
+                    return;
+            }
+            side = parent_side;
+        }
+    }
+
     TreeNode *balance(TreeNode *root)
     {
-        uint32_t lh = root->left ? root->left->height : 0, rh = root->right ? root->right->height : 0;
+        uint32_t lh = root->left() ? root->left()->height : 0, rh = root->right() ? root->right()->height : 0;
 
         if (lh > 1 + rh)
         {
-            TreeNode *left = root->left;
-            uint32_t llh = left->left ? left->left->height : 0, lrh = left->right ? left->right->height : 0;
+            TreeNode *left = root->left();
+            uint32_t llh = left->left() ? left->left()->height : 0, lrh = left->right() ? left->right()->height : 0;
 
             // Double rotate
             if (lrh > llh)
             {
-                root->left = left_rotate(left, left->right);
+                root->set_left(left_rotate(left, left->right()));
             }
 
-            return right_rotate(root, root->left);
+            return right_rotate(root, root->left());
         }
 
         else if (rh > 1 + lh)
         {
-            TreeNode *right = root->right;
-            uint32_t rlh = right->left ? right->left->height : 0, rrh = right->right ? right->right->height : 0;
+            TreeNode *right = root->right();
+            uint32_t rlh = right->left() ? right->left()->height : 0, rrh = right->right() ? right->right()->height : 0;
 
             // Double rotate
             if (rlh > rrh)
             {
-                root->right = right_rotate(right, right->left);
+                root->set_right(right_rotate(right, right->left()));
             }
 
-            return left_rotate(root, root->right);
+            return left_rotate(root, root->right());
         }
 
         update_height(root);
@@ -6,7 +6,11 @@
 #include <chrono>
 #include <random>
 #include <iomanip>
+#include <string>
+#include <span>
+#include <memory>
 #include "avl_tree.h"
+#include "../Common/counting_allocator.h"
 
 using namespace std;
 
@@ -50,7 +54,7 @@ private:
         }
         
         // Recursively check left and right subtrees with updated bounds.
-        return is_bst_valid<T, Compare>(node->left, min_val, &node->val) && is_bst_valid<T, Compare>(node->right, &node->val, max_val);
+        return is_bst_valid<T, Compare>(node->left(), min_val, &node->val) && is_bst_valid<T, Compare>(node->right(), &node->val, max_val);
     }
 
     // 2. Recursively checks height correctness and the AVL balance property.
@@ -60,8 +64,8 @@ private:
         if (!is_valid) return 0; // Stop early if an error was found elsewhere
         if (node == nullptr) return 0;
 
-        int left_height = check_height_and_balance<T, Compare>(node->left, is_valid);
-        int right_height = check_height_and_balance<T, Compare>(node->right, is_valid);
+        int left_height = check_height_and_balance<T, Compare>(node->left(), is_valid);
+        int right_height = check_height_and_balance<T, Compare>(node->right(), is_valid);
 
         // Check the AVL balance factor property
         if (abs(left_height - right_height) > 1) {
@@ -88,6 +92,13 @@ public:
         test_clear();
         test_large_data_set();
         test_random_operations();
+        test_from_sorted();
+        test_allocators();
+        test_comparators();
+        test_memory_usage();
+        test_stats();
+        test_find_batch();
+        test_packed_layout();
         test_performance_comparison();
         cout << "\nAll AVLTree tests passed successfully!" << endl;
     }
@@ -117,7 +128,7 @@ public:
         // Ensure it's a deep copy
         assert(original.node != copied.node);
         if (original.node && copied.node) {
-             assert(original.node->left != copied.node->left);
+             assert(original.node->left() != copied.node->left());
         }
 
         // Modify copied and check original is unchanged
@@ -323,6 +334,199 @@ public:
         cout << "PASSED" << endl;
     }
     
+    static void test_from_sorted() {
+        cout << "Testing bulk load from sorted data... ";
+        for (int n = 0; n <= 2000; n += n < 70 ? 1 : 97) {
+            vector<int> data(n);
+            for (int i = 0; i < n; ++i) data[i] = 2 * i;
+
+            AVLTree<int> tree = AVLTree<int>::from_sorted(data.begin(), data.end());
+            assert(is_avl_tree_valid(tree));
+            for (int i = 0; i < 2 * n; ++i) {
+                assert(tree.find(i) == (i % 2 == 0));
+            }
+
+            // Still a working tree afterwards
+            for (int i = 1; i < 2 * n; i += 2) {
+                assert(tree.add(i));
+            }
+            assert(is_avl_tree_valid(tree));
+        }
+        cout << "PASSED" << endl;
+    }
+
+    // Same behaviour through global new/delete and through the pool with non-trivial values
+    template <typename Tree, typename Make>
+    static void check_against_set(Make make) {
+        Tree tree;
+        set<int> std_set;
+        mt19937 rng(42);
+        uniform_int_distribution<int> dist_val(0, 2000);
+
+        for (int i = 0; i < 20000; ++i) {
+            int val = dist_val(rng);
+            switch (rng() % 3) {
+                case 0: assert(tree.add(make(val)) == std_set.insert(val).second); break;
+                case 1: assert(tree.find(make(val)) == (std_set.count(val) > 0)); break;
+                default: assert(tree.remove(make(val)) == (std_set.erase(val) > 0)); break;
+            }
+        }
+
+        Tree copied = tree, moved = std::move(tree);
+        for (int val = 0; val <= 2000; ++val) {
+            assert(copied.find(make(val)) == (std_set.count(val) > 0));
+            assert(moved.find(make(val)) == (std_set.count(val) > 0));
+        }
+        copied.clear();
+        assert(!copied.find(make(*std_set.begin())) && moved.find(make(*std_set.begin())));
+        assert(copied.add(make(1)) && copied.find(make(1)));
+    }
+
+    static void test_allocators() {
+        cout << "Testing node allocators... ";
+        check_against_set<AVLTree<int, less<int>, allocator<int>>>([](int val) { return val; });
+        check_against_set<AVLTree<string>>([](int val) { return string(40, 'k') + to_string(val); });
+        cout << "PASSED" << endl;
+    }
+
+    // Three-way comparators are used directly, bool comparators other than std::less take the two-call path
+    static void test_comparators() {
+        cout << "Testing comparators... ";
+        check_against_set<AVLTree<string, compare_three_way>>([](int val) { return string(40, 'k') + to_string(val); });
+        check_against_set<AVLTree<int, greater<int>>>([](int val) { return val; });
+        cout << "PASSED" << endl;
+    }
+
+    // memory_usage() walks the nodes; a CountingAllocator sees the same bytes from the allocation side
+    static void test_memory_usage() {
+        cout << "Testing memory usage... ";
+        // The tree default-constructs its allocator, which counts into the process-wide counter
+        AllocationCounter &counter = default_allocation_counter();
+        counter.reset();
+        {
+            AVLTree<int, less<int>, CountingAllocator<int>> tree;
+            assert(tree.memory_usage().bytes == 0);
+            for (int i = 0; i < 1000; ++i) tree.add(i);
+
+            auto usage = tree.memory_usage();
+            assert(usage.keys == 1000 && usage.nodes == 1000 && usage.fill == 1.0);
+            assert(usage.leaves + usage.internals == usage.nodes);
+            assert(usage.bytes == counter.live_bytes && counter.allocations == 1000);
+
+            for (int i = 0; i < 500; ++i) tree.remove(i);
+            assert(tree.memory_usage().bytes == counter.live_bytes);
+            assert(counter.peak_bytes == usage.bytes);
+        }
+        assert(counter.live_bytes == 0);
+
+        // The pool reports whole slabs, which is what bytes_per_key() charges for
+        AVLTree<int> pooled;
+        for (int i = 0; i < 1000; ++i) pooled.add(i);
+        auto usage = pooled.memory_usage();
+        assert(usage.reserved >= usage.bytes);
+        assert(usage.bytes_per_key() == static_cast<double>(usage.reserved) / 1000);
+        cout << "PASSED" << endl;
+    }
+
+    static void test_stats() {
+        cout << "Testing instrumentation counters... ";
+        AVLTree<int, less<int>, NodePool<int>, TreeStats> tree;
+        for (int x : {1, 2, 3}) tree.add(x);
+        assert(tree.stats().rotations == 1);
+
+        tree.reset_stats();
+        for (int x : {6, 5}) tree.add(x); // 5 lands left of 6 under 3 - a double rotation
+        assert(tree.stats().rotations == 2);
+
+        tree.reset_stats();
+        assert(tree.find(2) && tree.find(5));
+        assert(tree.stats().visits == 3 && tree.stats().comparisons == 3);
+        cout << "PASSED" << endl;
+    }
+
+    static void test_find_batch() {
+        cout << "Testing find_batch... ";
+        // Lengths around the lockstep group size, over an empty and a populated tree
+        std::mt19937 gen(3);
+        AVLTree<int> tree;
+        std::set<int> model;
+        for (int round = 0; round < 2; ++round)
+        {
+            for (std::size_t length : {0, 1, 15, 16, 17, 1000})
+            {
+                std::vector<int> keys(length);
+                for (int &key : keys)
+                    key = gen() % 20000;
+                std::unique_ptr<bool[]> out(new bool[length + 1]);
+                tree.find_batch(std::span<const int>(keys), std::span<bool>(out.get(), length));
+                for (std::size_t i = 0; i < length; ++i)
+                    assert(out[i] == model.contains(keys[i]));
+            }
+
+            for (int i = 0; i < 5000; ++i)
+            {
+                int val = gen() % 10000;
+                tree.add(val);
+                model.insert(val);
+            }
+        }
+        cout << "PASSED" << endl;
+    }
+
+    // Packed nodes: search order, and a stored balance factor equal to the real height difference everywhere
+    template <typename Tree>
+    static int check_packed(const typename Tree::TreeNode* node, const int* min_val, const int* max_val) {
+        if (node == nullptr) return 0;
+        assert((!min_val || *min_val < node->val) && (!max_val || node->val < *max_val));
+
+        int left_height = check_packed<Tree>(node->left(), min_val, &node->val);
+        int right_height = check_packed<Tree>(node->right(), &node->val, max_val);
+        assert(node->balance() == right_height - left_height);
+        return 1 + max(left_height, right_height);
+    }
+
+    static void test_packed_layout() {
+        cout << "Testing packed node layout... ";
+        // The balance factor moves into the left pointer - the height field and its padding go
+        static_assert(sizeof(AVLTree<int, less<int>, NodePool<int>, NoStats, PackedLayout>::TreeNode) == 3 * sizeof(void*));
+        static_assert(sizeof(AVLTree<int, less<int>, NodePool<int>, NoStats, PackedLayout>::TreeNode) < sizeof(AVLTree<int>::TreeNode));
+
+        using Packed = AVLTree<int, less<int>, NodePool<int>, NoStats, PackedLayout>;
+        check_against_set<Packed>([](int val) { return val; });
+        check_against_set<AVLTree<string, less<string>, allocator<string>, NoStats, PackedLayout>>([](int val) { return to_string(val); });
+
+        // Every insert and delete case, checked as it happens - sequential runs force the single rotations,
+        // random ones the double rotations and the deletes that leave a rotated subtree its height
+        mt19937 rng(7);
+        Packed tree;
+        set<int> std_set;
+        for (int i = 0; i < 3000; ++i) {
+            int val = i < 1000 ? i : static_cast<int>(rng() % 2000);
+            if (i < 1000 || rng() % 2)
+                assert(tree.add(val) == std_set.insert(val).second);
+            else
+                assert(tree.remove(val) == (std_set.erase(val) > 0));
+            check_packed<Packed>(tree.node, nullptr, nullptr);
+        }
+        while (!std_set.empty()) {
+            int val = *std_set.begin();
+            assert(tree.remove(val) && std_set.erase(val));
+            check_packed<Packed>(tree.node, nullptr, nullptr);
+        }
+
+        for (int n = 0; n <= 300; ++n) {
+            vector<int> data(n);
+            for (int i = 0; i < n; ++i) data[i] = 2 * i;
+            Packed bulk = Packed::from_sorted(data.begin(), data.end());
+            check_packed<Packed>(bulk.node, nullptr, nullptr);
+            Packed copy = bulk;
+            check_packed<Packed>(copy.node, nullptr, nullptr);
+            for (int i = 1; i < 2 * n; i += 4) assert(bulk.add(i));
+            check_packed<Packed>(bulk.node, nullptr, nullptr);
+        }
+        cout << "PASSED" << endl;
+    }
+
     static void test_performance_comparison() {
         cout << "\n--- Performance Comparison (AVLTree vs std::set) ---" << endl;
         const int num_elements = 100000;
@@ -0,0 +1,636 @@
+#ifndef __BPLUSTREE_H__
+#define __BPLUSTREE_H__
+
+#include <utility>
+#include <span>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <stack>
+#include <cstddef>
+#include <algorithm>
+
+#include "node_search.h"
+#include "../Common/compare.h"
+#include "../Common/memory_usage.h"
+#include "../Common/prefetch.h"
+
+// B+Tree - every key lives in a leaf, internal nodes only hold separators (left < sep <= right)
+// Leaves are chained left to right so ordered scans stream leaf arrays instead of walking the tree
+template <typename T, std::size_t N, typename Compare = std::less<T>>
+requires (N > 1)
+class BPlusTree
+{
+private: // Node layout
+    // N as the int that node positions and key counts are
+    static constexpr int ORDER = static_cast<int>(N);
+
+    struct Node
+    {
+        T keys[2 * N - 1];
+        int num_keys;
+        bool leaf;
+
+        Node(bool leaf) : num_keys(0), leaf(leaf) {}
+    };
+
+    struct Leaf : Node
+    {
+        Leaf *next;
+
+        Leaf() : Node(true), next(nullptr) {}
+    };
+
+    struct Internal : Node
+    {
+        Node *children[2 * N] = {nullptr};
+
+        Internal() : Node(false) {}
+    };
+
+public:
+    // Forward iterator over the leaf chain
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator() : leaf(nullptr), idx(0) {}
+
+        reference operator*() const { return leaf->keys[idx]; }
+        pointer operator->() const { return &leaf->keys[idx]; }
+
+        const_iterator &operator++()
+        {
+            if (++idx == leaf->num_keys)
+            {
+                leaf = leaf->next;
+                idx = 0;
+
+                // Pull the leaf after this one in while the current one is consumed
+                if (leaf && leaf->next)
+                    __builtin_prefetch(leaf->next);
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const const_iterator &other) const { return leaf == other.leaf && idx == other.idx; }
+
+    private:
+        const_iterator(const Leaf *leaf, int idx) : leaf(leaf), idx(idx) {}
+
+        const Leaf *leaf;
+        int idx;
+
+        friend class BPlusTree;
+    };
+
+    // Half-open key range [lo, hi) usable in a range-for
+    struct Range
+    {
+        const_iterator first, last;
+
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+    };
+
+    // Constructor
+    BPlusTree() : root(nullptr) {}
+
+    // Destructor
+    ~BPlusTree()
+    {
+        clear(root);
+    }
+
+    // Copy
+    BPlusTree(const BPlusTree &other) : root(nullptr), less_than(other.less_than)
+    {
+        Leaf *prev = nullptr;
+        auto copy = [&prev](auto copy, const Node *root) -> Node *
+        {
+            if (root == nullptr)
+                return nullptr;
+
+            if (root->leaf)
+            {
+                Leaf *ret = new Leaf;
+                for (int i = 0; i < root->num_keys; i++)
+                    ret->keys[i] = root->keys[i];
+                ret->num_keys = root->num_keys;
+
+                // Leaves are copied left to right, so relink the chain as we go
+                if (prev)
+                    prev->next = ret;
+                prev = ret;
+                return ret;
+            }
+
+            const Internal *in = static_cast<const Internal *>(root);
+            Internal *ret = new Internal;
+            for (int i = 0; i < in->num_keys; i++)
+                ret->keys[i] = in->keys[i];
+            ret->num_keys = in->num_keys;
+            for (int i = 0; i <= in->num_keys; i++)
+                ret->children[i] = copy(copy, in->children[i]);
+            return ret;
+        };
+
+        root = copy(copy, other.root);
+    }
+
+    BPlusTree &operator=(const BPlusTree &other)
+    {
+        if (this == &other)
+            return *this;
+
+        BPlusTree new_tree(other);
+        std::swap(root, new_tree.root);
+        std::swap(less_than, new_tree.less_than);
+        return *this;
+    }
+
+    // Move
+    BPlusTree(BPlusTree &&other) noexcept : root(other.root), less_than(std::move(other.less_than))
+    {
+        other.root = nullptr;
+    }
+
+    BPlusTree &operator=(BPlusTree &&other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        clear(root);
+        root = other.root;
+        less_than = std::move(other.less_than);
+        other.root = nullptr;
+        return *this;
+    }
+
+    // Search
+    bool find(const T &val) const
+    {
+        if (root == nullptr)
+            return false;
+
+        const Leaf *leaf = find_leaf(val);
+        int idx = rank(leaf, val);
+        return idx > 0 && !is_less(less_than, leaf->keys[idx - 1], val);
+    }
+
+    // Batched search - out[i] = find(keys[i]). Walks FIND_BATCH_GROUP descents in lockstep and prefetches
+    // the keys of each one's next node, so the cache misses of independent lookups overlap instead of queueing
+    void find_batch(std::span<const T> keys, std::span<bool> out) const
+    {
+        assert(out.size() >= keys.size());
+        const Node *cursor[FIND_BATCH_GROUP];
+
+        for (std::size_t base = 0; base < keys.size(); base += FIND_BATCH_GROUP)
+        {
+            std::size_t n = std::min(FIND_BATCH_GROUP, keys.size() - base);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                cursor[i] = root;
+                out[base + i] = false;
+            }
+
+            // Every descent reaches a leaf at the same depth, so the group moves down one level per round
+            for (bool internal = root != nullptr && !root->leaf; internal;)
+            {
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    const Internal *in = static_cast<const Internal *>(cursor[i]);
+                    cursor[i] = in->children[rank(in, keys[base + i])];
+                    prefetch_range(cursor[i], sizeof(Node));
+                }
+                internal = !cursor[0]->leaf;
+            }
+
+            if (root != nullptr)
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    int idx = rank(cursor[i], keys[base + i]);
+                    out[base + i] = idx > 0 && !is_less(less_than, cursor[i]->keys[idx - 1], keys[base + i]);
+                }
+        }
+    }
+
+    // Insert
+    bool add(const T &val)
+    {
+        // No nodes
+        if (root == nullptr)
+        {
+            Leaf *leaf = new Leaf;
+            leaf->keys[leaf->num_keys++] = val;
+            root = leaf;
+            return true;
+        }
+
+        // Full root - create new root
+        if (root->num_keys == 2 * N - 1)
+        {
+            Internal *new_root = new Internal;
+            new_root->children[0] = root;
+            root = new_root;
+            split_child(new_root, 0);
+        }
+
+        // Iteratively preemptively split and descend
+        Node *curr = root;
+        while (!curr->leaf)
+        {
+            Internal *in = static_cast<Internal *>(curr);
+            int i = rank(in, val);
+
+            if (in->children[i]->num_keys == 2 * N - 1)
+            {
+                split_child(in, i);
+                if (!is_less(less_than, val, in->keys[i]))
+                    i++;
+            }
+
+            curr = in->children[i];
+        }
+
+        int i = rank(curr, val);
+
+        // Duplicate entry
+        if (i > 0 && !is_less(less_than, curr->keys[i - 1], val))
+            return false;
+
+        for (int idx = curr->num_keys++; idx > i; idx--)
+            curr->keys[idx] = std::move(curr->keys[idx - 1]);
+        curr->keys[i] = val;
+
+        return true;
+    }
+
+    // Delete
+    bool remove(const T &val)
+    {
+        if (root == nullptr)
+            return false;
+
+        // Preemptively top up every child on the path to N keys, so the leaf can lose one
+        Node *curr = root;
+        while (!curr->leaf)
+        {
+            Internal *in = static_cast<Internal *>(curr);
+            int i = rank(in, val);
+
+            if (in->children[i]->num_keys == N - 1)
+                i = fill_child(in, i);
+
+            curr = in->children[i];
+
+            // Merge emptied the root - tree height decreases
+            if (in == root && in->num_keys == 0)
+            {
+                root = curr;
+                delete in;
+            }
+        }
+
+        int i = rank(curr, val);
+        if (i == 0 || is_less(less_than, curr->keys[i - 1], val))
+            return false;
+
+        for (int idx = i; idx < curr->num_keys; idx++)
+            curr->keys[idx - 1] = std::move(curr->keys[idx]);
+        curr->num_keys--;
+
+        if (root->num_keys == 0) // Only happens if leaf is root
+        {
+            delete static_cast<Leaf *>(root);
+            root = nullptr;
+        }
+
+        return true;
+    }
+
+    void clear()
+    {
+        clear(root);
+        root = nullptr;
+    }
+
+    // Node counts, bytes held by nodes and key-slot fill - keys counts the leaves only,
+    // the separators in internal nodes are copies
+    MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage;
+        if (root == nullptr)
+            return usage;
+
+        std::size_t slots_used = 0;
+        std::stack<const Node *> st;
+        st.push(root);
+
+        while (!st.empty())
+        {
+            const Node *top = st.top();
+            st.pop();
+
+            slots_used += top->num_keys;
+            if (top->leaf)
+            {
+                usage.keys += top->num_keys;
+                usage.leaves++;
+                usage.bytes += sizeof(Leaf);
+            }
+
+            else
+            {
+                const Internal *in = static_cast<const Internal *>(top);
+                usage.internals++;
+                usage.bytes += sizeof(Internal);
+                for (int i = 0; i <= in->num_keys; i++)
+                    st.push(in->children[i]);
+            }
+        }
+
+        usage.nodes = usage.leaves + usage.internals;
+        usage.fill = static_cast<double>(slots_used) / (usage.nodes * (2 * N - 1));
+        return usage;
+    }
+
+    // Iteration
+    const_iterator begin() const
+    {
+        if (root == nullptr)
+            return end();
+
+        const Node *node = root;
+        for (; !node->leaf; node = static_cast<const Internal *>(node)->children[0])
+            ;
+        return const_iterator(static_cast<const Leaf *>(node), 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator();
+    }
+
+    // First key not less than val
+    const_iterator lower_bound(const T &val) const
+    {
+        if (root == nullptr)
+            return end();
+
+        const Leaf *leaf = find_leaf(val);
+        int idx = rank(leaf, val);
+        if (idx > 0 && !is_less(less_than, leaf->keys[idx - 1], val))
+            idx--;
+
+        if (idx == leaf->num_keys)
+            return const_iterator(leaf->next, 0);
+        return const_iterator(leaf, idx);
+    }
+
+    // All keys in [lo, hi), in order
+    Range range(const T &lo, const T &hi) const
+    {
+        if (!is_less(less_than, lo, hi))
+            return Range{end(), end()};
+        return Range{lower_bound(lo), lower_bound(hi)};
+    }
+
+private: // Attributes
+    Node *root;
+    Compare less_than;
+
+private: // Methods
+    static void clear(Node *root)
+    {
+        if (root == nullptr)
+            return;
+
+        std::stack<Node *> st;
+        st.push(root);
+
+        while (!st.empty())
+        {
+            Node *top = st.top();
+            st.pop();
+
+            if (top->leaf)
+                delete static_cast<Leaf *>(top);
+            else
+            {
+                Internal *in = static_cast<Internal *>(top);
+                for (int i = 0; i <= in->num_keys; i++)
+                    st.push(in->children[i]);
+                delete in;
+            }
+        }
+    }
+
+    // Number of keys <= val - for internal nodes this is the index of the child to descend into
+    int rank(const Node *node, const T &val) const
+    {
+        if constexpr (simd_searchable<T, Compare>)
+            return simd_rank(node->keys, node->num_keys, val);
+
+        int l = 0, r = node->num_keys - 1;
+
+        while (l <= r)
+        {
+            int m = (l + r) / 2;
+            if (is_less(less_than, val, node->keys[m]))
+                r = m - 1;
+            else
+                l = m + 1;
+        }
+
+        return l;
+    }
+
+    const Leaf *find_leaf(const T &val) const
+    {
+        const Node *node = root;
+        while (!node->leaf)
+        {
+            const Internal *in = static_cast<const Internal *>(node);
+            node = in->children[rank(in, val)];
+        }
+        return static_cast<const Leaf *>(node);
+    }
+
+    // Split full child i of parent, which has room for one more separator
+    static void split_child(Internal *parent, int i)
+    {
+        Node *child = parent->children[i];
+        Node *adj_node;
+
+        if (child->leaf)
+        {
+            // Right leaf takes the upper N keys, its first key is copied up as the separator
+            Leaf *left = static_cast<Leaf *>(child), *right = new Leaf;
+            for (int idx = ORDER - 1; idx < 2 * ORDER - 1; idx++)
+                right->keys[idx - (ORDER - 1)] = std::move(left->keys[idx]);
+            right->num_keys = ORDER;
+            left->num_keys = ORDER - 1;
+
+            right->next = left->next;
+            left->next = right;
+            adj_node = right;
+        }
+
+        else
+        {
+            // Median moves up, as in BTree
+            Internal *left = static_cast<Internal *>(child), *right = new Internal;
+            for (int idx = ORDER; idx < 2 * ORDER - 1; idx++)
+            {
+                right->keys[idx - ORDER] = std::move(left->keys[idx]);
+                right->children[idx - ORDER] = left->children[idx];
+                left->children[idx] = nullptr;
+            }
+            right->children[ORDER - 1] = left->children[2 * ORDER - 1];
+            left->children[2 * ORDER - 1] = nullptr;
+            right->num_keys = ORDER - 1;
+            left->num_keys = ORDER - 1;
+            adj_node = right;
+        }
+
+        for (int idx = parent->num_keys++; idx > i; idx--)
+        {
+            parent->keys[idx] = std::move(parent->keys[idx - 1]);
+            parent->children[idx + 1] = parent->children[idx];
+        }
+        if (adj_node->leaf)
+            parent->keys[i] = adj_node->keys[0];
+        else
+            parent->keys[i] = std::move(child->keys[ORDER - 1]);
+        parent->children[i + 1] = adj_node;
+    }
+
+    // Child i of parent has N - 1 keys - borrow from a sibling or merge with one
+    // Returns the index of the child that now covers the original key range
+    static int fill_child(Internal *parent, int i)
+    {
+        if (i > 0 && parent->children[i - 1]->num_keys >= ORDER)
+            borrow_left(parent, i);
+        else if (i < parent->num_keys && parent->children[i + 1]->num_keys >= ORDER)
+            borrow_right(parent, i);
+        else if (i < parent->num_keys)
+            merge(parent, i);
+        else
+            merge(parent, --i);
+
+        return i;
+    }
+
+    static void borrow_left(Internal *parent, int i)
+    {
+        Node *left = parent->children[i - 1], *child = parent->children[i];
+
+        for (int idx = child->num_keys; idx > 0; idx--)
+            child->keys[idx] = std::move(child->keys[idx - 1]);
+
+        if (child->leaf)
+        {
+            child->keys[0] = std::move(left->keys[left->num_keys - 1]);
+            parent->keys[i - 1] = child->keys[0];
+        }
+
+        else
+        {
+            Internal *l = static_cast<Internal *>(left), *c = static_cast<Internal *>(child);
+            for (int idx = c->num_keys + 1; idx > 0; idx--)
+                c->children[idx] = c->children[idx - 1];
+            c->keys[0] = std::move(parent->keys[i - 1]);
+            c->children[0] = l->children[l->num_keys];
+            l->children[l->num_keys] = nullptr;
+            parent->keys[i - 1] = std::move(l->keys[l->num_keys - 1]);
+        }
+
+        child->num_keys++;
+        left->num_keys--;
+    }
+
+    static void borrow_right(Internal *parent, int i)
+    {
+        Node *child = parent->children[i], *right = parent->children[i + 1];
+
+        if (child->leaf)
+        {
+            child->keys[child->num_keys] = std::move(right->keys[0]);
+            for (int idx = 1; idx < right->num_keys; idx++)
+                right->keys[idx - 1] = std::move(right->keys[idx]);
+            parent->keys[i] = right->keys[0];
+        }
+
+        else
+        {
+            Internal *c = static_cast<Internal *>(child), *r = static_cast<Internal *>(right);
+            c->keys[c->num_keys] = std::move(parent->keys[i]);
+            c->children[c->num_keys + 1] = r->children[0];
+            parent->keys[i] = std::move(r->keys[0]);
+            for (int idx = 1; idx < r->num_keys; idx++)
+            {
+                r->keys[idx - 1] = std::move(r->keys[idx]);
+                r->children[idx - 1] = r->children[idx];
+            }
+            r->children[r->num_keys - 1] = r->children[r->num_keys];
+            r->children[r->num_keys] = nullptr;
+        }
+
+        child->num_keys++;
+        right->num_keys--;
+    }
+
+    // Merge child i + 1 into child i and drop separator i
+    static void merge(Internal *parent, int i)
+    {
+        Node *left = parent->children[i], *right = parent->children[i + 1];
+
+        if (left->leaf)
+        {
+            Leaf *l = static_cast<Leaf *>(left), *r = static_cast<Leaf *>(right);
+            for (int idx = 0; idx < r->num_keys; idx++)
+                l->keys[l->num_keys++] = std::move(r->keys[idx]);
+            l->next = r->next;
+            delete r;
+        }
+
+        else
+        {
+            Internal *l = static_cast<Internal *>(left), *r = static_cast<Internal *>(right);
+            l->keys[l->num_keys++] = std::move(parent->keys[i]);
+            for (int idx = 0; idx < r->num_keys; idx++)
+            {
+                l->keys[l->num_keys] = std::move(r->keys[idx]);
+                l->children[l->num_keys++] = r->children[idx];
+            }
+            l->children[l->num_keys] = r->children[r->num_keys];
+            delete r;
+        }
+
+        for (int idx = i + 1; idx < parent->num_keys; idx++)
+        {
+            parent->keys[idx - 1] = std::move(parent->keys[idx]);
+            parent->children[idx] = parent->children[idx + 1];
+        }
+        parent->children[parent->num_keys] = nullptr;
+        parent->num_keys--;
+    }
+
+private: // Friend tester class
+    friend class BPlusTreeTester;
+};
+
+#endif
@@ -2,11 +2,22 @@
 #define __BTREE_H__
 
 #include <utility>
+#include <span>
+#include <cassert>
 #include <functional>
 #include <stack>
 #include <cstdint>
+#include <iterator>
+#include <algorithm>
 
-template <typename T, std::size_t N, typename Compare = std::less<T>>
+#include "node_search.h"
+#include "../Common/compare.h"
+#include "../Common/memory_usage.h"
+#include "../Common/instrumentation.h"
+#include "../Common/prefetch.h"
+#include "../Common/lookup_task.h"
+
+template <typename T, std::size_t N, typename Compare = std::less<T>, typename Stats = NoStats>
 requires (N > 1)
 class BTree
 {
@@ -28,13 +39,13 @@ public:
             if (root == nullptr)
                 return nullptr;
 
-            Node *ret = new Node;
-            for (int i = 0; i < 2 * N - 1; i++)
+            Node *ret = make_node(root->leaf);
+            for (int i = 0; i < root->num_keys; i++)
                 ret->keys[i] = root->keys[i];
-            ret->leaf = root->leaf;
             ret->num_keys = root->num_keys;
-            for (int i = 0; i < 2 * N; i++)
-                ret->children[i] = copy(copy, root->children[i]);
+            if (!root->leaf)
+                for (int i = 0; i <= root->num_keys; i++)
+                    children(ret)[i] = copy(copy, children(root)[i]);
 
             return ret;
         };
@@ -72,33 +83,117 @@ public:
         return *this;
     }
 
+    // Bulk load from a sorted, duplicate-free range in O(n)
+    // Picks the lowest height that fits n keys, then splits each subtree's keys evenly between
+    // as few children as fit (at least N below the root), which keeps every node within [N - 1, 2N - 1]
+    template <std::forward_iterator It>
+    static BTree from_sorted(It first, It last)
+    {
+        std::size_t n = std::distance(first, last);
+        BTree tree;
+        if (n == 0)
+            return tree;
+
+        // Capacity of a subtree is (2N)^(height + 1) - 1 keys
+        int height = 0;
+        std::size_t capacity = 2 * N - 1;
+        for (; capacity < n; height++)
+            capacity = (capacity + 1) * 2 * N - 1;
+
+        auto build = [&](auto build, std::size_t count, int height, std::size_t capacity, bool is_root) -> Node *
+        {
+            Node *ret = make_node(height == 0);
+            if (height == 0)
+            {
+                for (; ret->num_keys < static_cast<int>(count); ++first)
+                    ret->keys[ret->num_keys++] = *first;
+                return ret;
+            }
+
+            std::size_t child_capacity = (capacity + 1) / (2 * N) - 1;
+            std::size_t num_children = (count + 1 + child_capacity) / (child_capacity + 1);
+            num_children = std::max<std::size_t>(num_children, is_root ? 2 : N);
+
+            std::size_t child_keys = count - (num_children - 1);
+            for (std::size_t i = 0; i < num_children; i++)
+            {
+                std::size_t share = child_keys / num_children + (i < child_keys % num_children);
+                children(ret)[i] = build(build, share, height - 1, child_capacity, false);
+                if (i + 1 < num_children)
+                {
+                    ret->keys[ret->num_keys++] = *first;
+                    ++first;
+                }
+            }
+            return ret;
+        };
+
+        tree.root = build(build, n, height, capacity, true);
+        return tree;
+    }
+
     // Search
-    bool find(const T &val)
+    bool find(const T &val) const
     {
         Node *node = root;
 
         while (node != nullptr)
         {
-            int idx = bin_search(node, val);
-            if (idx < 0)
-                node = node->children[0];
-            else if (node->keys[idx] == val)
+            bool found;
+            int idx = bin_search(node, val, found);
+            if (found)
                 return true;
+            else if (node->leaf)
+                return false;
             else
-                node = node->children[idx + 1];
+                node = children(node)[idx + 1];
         }
 
         return false;
     }
 
+    // Batched search - out[i] = find(keys[i]), FIND_BATCH_GROUP descents at a time in lockstep (run_lockstep)
+    void find_batch(std::span<const T> keys, std::span<bool> out) const
+    {
+        run_lockstep(keys, out, root, [this](const T &val, Node *node, bool &found) -> Node *
+        {
+            int idx = bin_search(node, val, found);
+            return node->leaf ? nullptr : children(node)[idx + 1];
+        });
+    }
+
+    // Coroutine lookup - suspends after prefetching the keys of each node on the way down; val must outlive the task
+    LookupTask find_task(const T &val) const
+    {
+        for (Node *node = root; node;)
+        {
+            bool found;
+            int idx = bin_search(node, val, found);
+            if (found)
+                co_return true;
+            if (node->leaf)
+                co_return false;
+
+            node = children(node)[idx + 1];
+            co_await prefetched{node, sizeof(Node)};
+        }
+
+        co_return false;
+    }
+
+    // The same lookups as coroutines, in_flight of them interleaved by a round-robin scheduler
+    void find_interleaved(std::span<const T> keys, std::span<bool> out, std::size_t in_flight = FIND_BATCH_GROUP) const
+    {
+        run_interleaved(keys, out, in_flight, [this](const T &val) { return find_task(val); });
+    }
+
     // Insert
     bool add(const T &val)
     {
         // No nodes
         if (root == nullptr)
         {
-            Node *node = new Node;
-            node->leaf = true;
+            Node *node = make_node(true);
             node->keys[0] = val;
             node->num_keys++;
             root = node;
@@ -108,14 +203,13 @@ public:
         // Full root - create new root
         if (root->num_keys == 2 * N - 1)
         {
-            Node *adj_node = new Node, *new_root = new Node, *curr = root;
+            Node *curr = root, *adj_node = make_node(curr->leaf), *new_root = make_node(false);
 
             // Initialize new root
-            new_root->leaf = false;
             new_root->num_keys++;
             new_root->keys[0] = std::move(curr->keys[N - 1]);
-            new_root->children[0] = curr;
-            new_root->children[1] = adj_node;
+            children(new_root)[0] = curr;
+            children(new_root)[1] = adj_node;
             root = new_root;
             
             split_divide(curr, adj_node);
@@ -126,10 +220,11 @@ public:
 
         while (curr)
         {
-            int i = bin_search(curr, val);
+            bool found;
+            int i = bin_search(curr, val, found);
 
             // Duplicate entry
-            if (i >= 0 && val == curr->keys[i])
+            if (found)
                 return false;
 
             i++;
@@ -145,31 +240,33 @@ public:
 
             else
             {
-                if (curr->children[i]->num_keys == 2 * N - 1)
+                if (children(curr)[i]->num_keys == 2 * N - 1)
                 {
-                    Node *adj_node = new Node, *curr_node = curr->children[i];
+                    Node *curr_node = children(curr)[i], *adj_node = make_node(curr_node->leaf);
 
                     // Initialize median of child here
                     for (int idx = curr->num_keys++; idx > i; idx--)
                     {
                         curr->keys[idx] = std::move(curr->keys[idx - 1]);
-                        curr->children[idx+1] = curr->children[idx];
+                        children(curr)[idx+1] = children(curr)[idx];
                     }
                     curr->keys[i] = curr_node->keys[N-1];
-                    curr->children[i+1] = adj_node;
+                    children(curr)[i+1] = adj_node;
                     
                     split_divide(curr_node, adj_node);
 
-                    if (less_than(val, curr->keys[i]))
-                        curr = curr->children[i];
-                    else if (val == curr->keys[i])
+                    counters.comparison();
+                    std::weak_ordering cmp = three_way(less_than, val, curr->keys[i]);
+                    if (cmp < 0)
+                        curr = children(curr)[i];
+                    else if (cmp == 0)
                         return false;
                     else
-                        curr = curr->children[i+1];
+                        curr = children(curr)[i+1];
                 }
 
                 else
-                    curr = curr->children[i];
+                    curr = children(curr)[i];
             }
         }
         
@@ -183,53 +280,54 @@ public:
             return false;
 
         // If root has 1 key and left keys == right keys == N - 1 => only then does height decrease (new root needed)
-        if (root->num_keys == 1 && root->children[0] && root->children[0]->num_keys == N - 1 && root->children[1]->num_keys == N - 1)
+        if (root->num_keys == 1 && !root->leaf && children(root)[0]->num_keys == N - 1 && children(root)[1]->num_keys == N - 1)
         {
-            merge(root->children[0], root->children[1], std::move(root->keys[0]));
-            delete root->children[1];
+            merge(children(root)[0], children(root)[1], std::move(root->keys[0]));
+            destroy(children(root)[1]);
             Node *del = root;
-            root = root->children[0];
-            delete del;
+            root = children(root)[0];
+            destroy(del);
         }
 
         Node *node = root;
 
         while (!node->leaf)
         {
-            int idx = bin_search(node, val);
+            bool found;
+            int idx = bin_search(node, val, found);
 
             // 2. In internal node
-            if (idx >= 0 && node->keys[idx] == val)
+            if (found)
             {
                 // 2a. internal node - child with predecessor has at least N keys
-                if (node->children[idx]->num_keys >= N)
+                if (children(node)[idx]->num_keys >= N)
                 {
                     // Find inorder predecessor
-                    Node *src = node->children[idx];
-                    for (; src->children[src->num_keys]; src = src->children[src->num_keys])
+                    Node *src = children(node)[idx];
+                    for (; !src->leaf; src = children(src)[src->num_keys])
                         ;
     
                     std::swap(node->keys[idx], src->keys[src->num_keys - 1]);
-                    node = node->children[idx];
+                    node = children(node)[idx];
                 }
     
                 // 2b. internal node - child with successor has at least N keys
-                else if (node->children[idx + 1]->num_keys >= N)
+                else if (children(node)[idx + 1]->num_keys >= N)
                 {
                     // Find inorder predecessor
-                    Node *src = node->children[idx + 1];
-                    for (; src->children[0]; src = src->children[0])
+                    Node *src = children(node)[idx + 1];
+                    for (; !src->leaf; src = children(src)[0])
                         ;
     
                     std::swap(node->keys[idx], src->keys[0]);
-                    node = node->children[idx + 1];
+                    node = children(node)[idx + 1];
                 }
     
                 // 2c. internal node - children with predecessor and successor have N - 1 keys - merge operation
                 else
                 {
                     merge_right(node, idx);
-                    node = node->children[idx];
+                    node = children(node)[idx];
                 }
             }
     
@@ -237,8 +335,8 @@ public:
             else
             {
                 idx++;
-                if (node->children[idx]->num_keys >= N)
-                    node = node->children[idx];
+                if (children(node)[idx]->num_keys >= N)
+                    node = children(node)[idx];
     
                 // 3a. Child has N - 1 keys - do a "rotation of keys"
                 // 3b. Both children have N - 1 keys = merge operation
@@ -247,68 +345,69 @@ public:
                 {
                     if (idx == 0)
                     {
-                        if (node->children[idx + 1]->num_keys >= N) // 3a
+                        if (children(node)[idx + 1]->num_keys >= N) // 3a
                         {
                             left_shift(node, idx);
-                            node = node->children[idx];
+                            node = children(node)[idx];
                         }
     
                         // 3b
                         else
                         {
                             merge_right(node, idx);
-                            node = node->children[idx];
+                            node = children(node)[idx];
                         }
                     }
     
                     // Rightmost child - consider only left sibling
                     else if (idx == node->num_keys)
                     {
-                        if (node->children[idx - 1]->num_keys >= N) // 3a
+                        if (children(node)[idx - 1]->num_keys >= N) // 3a
                         {
                             right_shift(node, idx);
-                            node = node->children[idx];
+                            node = children(node)[idx];
                         }
     
                         // 3b
                         else
                         {
-                            merge(node->children[idx - 1], node->children[idx], std::move(node->keys[idx - 1]));
-                            delete node->children[idx];
-                            node->children[idx] = nullptr;
+                            merge(children(node)[idx - 1], children(node)[idx], std::move(node->keys[idx - 1]));
+                            destroy(children(node)[idx]);
+                            children(node)[idx] = nullptr;
                             node->num_keys--;
-                            node = node->children[idx - 1];
+                            node = children(node)[idx - 1];
                         }
                     }
     
                     else
                     {
                         // 3a
-                        if (node->children[idx + 1]->num_keys >= N)
+                        if (children(node)[idx + 1]->num_keys >= N)
                         {
                             left_shift(node, idx);
-                            node = node->children[idx];
+                            node = children(node)[idx];
                         }
     
-                        else if (node->children[idx - 1]->num_keys >= N)
+                        else if (children(node)[idx - 1]->num_keys >= N)
                         {
                             right_shift(node, idx);
-                            node = node->children[idx];
+                            node = children(node)[idx];
                         }
     
                         // 3b
                         else
                         {
                             merge_right(node, idx);
-                            node = node->children[idx];
+                            node = children(node)[idx];
                         }
                     }
                 }
             }
         }
 
-        int idx = bin_search(node, val);
-        if (idx >= 0 && node->keys[idx] == val)
+        bool found;
+        int idx = bin_search(node, val, found);
+        if (found)
         {
             // Actually delete
             for (int i = idx + 1; i < node->num_keys; i++)
@@ -317,7 +416,7 @@ public:
             
             if (root->num_keys == 0) // Only happens if node is root
             {
-                delete root;
+                destroy(root);
                 root = nullptr;
             }
 
@@ -327,19 +426,67 @@ public:
         return false;
     }
 
+    // Node counts, bytes held by nodes and key-slot fill
+    MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage;
+        if (root == nullptr)
+            return usage;
+
+        std::stack<Node *> st;
+        st.push(root);
+
+        while (!st.empty())
+        {
+            Node *top = st.top();
+            st.pop();
+
+            usage.keys += top->num_keys;
+            if (top->leaf)
+            {
+                usage.leaves++;
+                usage.bytes += sizeof(Node);
+            }
+
+            else
+            {
+                usage.internals++;
+                usage.bytes += sizeof(Internal);
+                for (int i = 0; i <= top->num_keys; i++)
+                    st.push(children(top)[i]);
+            }
+        }
+
+        usage.nodes = usage.leaves + usage.internals;
+        usage.fill = static_cast<double>(usage.keys) / (usage.nodes * (2 * N - 1));
+        return usage;
+    }
+
+    // Instrumentation counters - all zero-cost no-ops unless the tree was instantiated with a counting policy
+    const Stats &stats() const { return counters; }
+    void reset_stats() { counters.reset(); }
+
 private: // Attributes
+    // Leaves are bare Nodes - only internal nodes pay for the child array
     struct Node
     {
         T keys[2 * N - 1];
-        Node *children[2 * N] = {nullptr};
         int num_keys;
         bool leaf;
 
-        Node() : num_keys(0), leaf(false) {}
+        Node(bool leaf) : num_keys(0), leaf(leaf) {}
+    };
+
+    struct Internal : Node
+    {
+        Node *children[2 * N] = {nullptr};
+
+        Internal() : Node(false) {}
     };
 
     Node *root;
     Compare less_than;
+    [[no_unique_address]] mutable Stats counters;
 
 private: // Methods
     static void clear(Node *root)
@@ -353,111 +500,156 @@ private: // Methods
         while (!st.empty())
         {
             Node *top = st.top();
+            st.pop();
+
             if (!top->leaf)
-            {
-                top->leaf = true;
                 for (int i = 0; i <= top->num_keys; i++)
-                    st.push(top->children[i]);
-            }
-
-            else
-            {
-                delete top;
-                st.pop();
-            }
+                    st.push(children(top)[i]);
+            destroy(top);
         }
     }
 
-    int bin_search(Node *node, const T &val)
+    static Node *make_node(bool leaf)
+    {
+        return leaf ? new Node(true) : new Internal;
+    }
+
+    static void destroy(Node *node)
+    {
+        if (node->leaf)
+            delete node;
+        else
+            delete static_cast<Internal *>(node);
+    }
+
+    static Node **children(Node *node)
     {
+        return static_cast<Internal *>(node)->children;
+    }
+
+    // Keys of arithmetic type under the default ordering are searched with the vectorised rank kernel
+    static constexpr bool simd_search = simd_searchable<T, Compare>;
+
+    // Index of the last key <= val, -1 if none; found tells whether that key is val
+    // The vectorised rank calls no comparator, so it only counts the visit
+    int bin_search(Node *node, const T &val, bool &found) const
+    {
+        counters.visit();
+        if constexpr (simd_search)
+        {
+            int r = simd_rank(node->keys, node->num_keys, val) - 1;
+            found = r >= 0 && node->keys[r] == val;
+            return r;
+        }
+
+        // One three-way comparison per probe, stopping as soon as val is hit
         int l = 0, r = node->num_keys - 1;
 
         while (l <= r)
         {
             int m = (l + r) / 2;
-            if (less_than(val, node->keys[m]))
+            counters.comparison();
+            std::weak_ordering cmp = three_way(less_than, val, node->keys[m]);
+            if (cmp == 0)
+            {
+                found = true;
+                return m;
+            }
+            else if (cmp < 0)
                 r = m - 1;
             else
                 l = m + 1;
         }
 
+        found = false;
         return r;
     }
 
-    static void split_divide(Node *curr, Node *adj_node)
+    void split_divide(Node *curr, Node *adj_node)
     {
+        counters.split();
         // Shift right half of elements to adjacent node
         // Move child pointers too
-        adj_node->leaf = curr->leaf;
         adj_node->num_keys = N - 1;
         curr->num_keys = N - 1;
 
         for (int i = N; i < 2 * N - 1; i++)
-        {
             adj_node->keys[i - N] = std::move(curr->keys[i]);
-            adj_node->children[i - N] = curr->children[i];
-            curr->children[i] = nullptr;
-        }
 
-        adj_node->children[N - 1] = curr->children[2 * N - 1];
-        curr->children[2 * N - 1] = nullptr;
+        if (curr->leaf)
+            return;
+
+        for (int i = N; i < 2 * N; i++)
+        {
+            children(adj_node)[i - N] = children(curr)[i];
+            children(curr)[i] = nullptr;
+        }
     }
 
-    static void merge(Node *mer_node, Node *adj_node, T &&median)
+    void merge(Node *mer_node, Node *adj_node, T &&median)
     {
+        counters.merge();
         mer_node->keys[mer_node->num_keys++] = std::move(median);
 
         for (int i = mer_node->num_keys; i < 2 * N - 1; i++, mer_node->num_keys++)
         {
             mer_node->keys[i] = std::move(adj_node->keys[i - N]);
-            mer_node->children[i] = adj_node->children[i - N];
+            if (!mer_node->leaf)
+                children(mer_node)[i] = children(adj_node)[i - N];
         }
-        mer_node->children[mer_node->num_keys] = adj_node->children[mer_node->num_keys - N];
+        if (!mer_node->leaf)
+            children(mer_node)[mer_node->num_keys] = children(adj_node)[mer_node->num_keys - N];
     }
 
-    static void left_shift(Node *root, int idx)
+    void left_shift(Node *root, int idx)
     {
-        Node *left = root->children[idx], *right = root->children[idx + 1];
+        counters.borrow();
+        Node *left = children(root)[idx], *right = children(root)[idx + 1];
         left->keys[left->num_keys++] = std::move(root->keys[idx]);
-        left->children[left->num_keys] = right->children[0];
         root->keys[idx] = std::move(right->keys[0]);
         
         right->num_keys--;
-        int i;
-        for (i = 0; i < right->num_keys; i++)
-        {
+        for (int i = 0; i < right->num_keys; i++)
             right->keys[i] = std::move(right->keys[i + 1]);
-            right->children[i] = right->children[i + 1];
-        }
-        right->children[i] = right->children[i + 1];
+
+        if (left->leaf)
+            return;
+
+        children(left)[left->num_keys] = children(right)[0];
+        for (int i = 0; i <= right->num_keys; i++)
+            children(right)[i] = children(right)[i + 1];
     }
 
-    static void right_shift(Node *root, int idx)
+    void right_shift(Node *root, int idx)
     {
-        Node *left = root->children[idx - 1], *right = root->children[idx];
+        counters.borrow();
+        Node *left = children(root)[idx - 1], *right = children(root)[idx];
         right->num_keys++;
-        right->children[right->num_keys] = right->children[right->num_keys - 1];
         for (int i = right->num_keys - 1; i > 0; i--)
-        {
             right->keys[i] = std::move(right->keys[i - 1]);
-            right->children[i] = right->children[i - 1];
+
+        if (!right->leaf)
+        {
+            for (int i = right->num_keys; i > 0; i--)
+                children(right)[i] = children(right)[i - 1];
+            children(right)[0] = children(left)[left->num_keys];
         }
         
         right->keys[0] = std::move(root->keys[idx - 1]);
-        right->children[0] = left->children[left->num_keys--];
+        left->num_keys--;
         root->keys[idx - 1] = std::move(left->keys[left->num_keys]);
     }
 
-    static void merge_right(Node *node, int idx)
+    void merge_right(Node *node, int idx)
     {
-        merge(node->children[idx], node->children[idx + 1], std::move(node->keys[idx]));
-        delete node->children[idx + 1];
+        merge(children(node)[idx], children(node)[idx + 1], std::move(node->keys[idx]));
+        destroy(children(node)[idx + 1]);
         for (int i = idx + 1; i < node->num_keys; i++)
         {
             node->keys[i - 1] = std::move(node->keys[i]);
-            node->children[i] = node->children[i + 1];
+            children(node)[i] = children(node)[i + 1];
         }
-        node->children[node->num_keys] = nullptr;
+        children(node)[node->num_keys] = nullptr;
         node->num_keys--;
     }
 
@@ -0,0 +1,362 @@
+#ifndef __CONCURRENT_BTREE_H__
+#define __CONCURRENT_BTREE_H__
+
+#include <atomic>
+#include <functional>
+#include <stack>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+#include "../Common/compare.h"
+#include "../Common/backoff.h"
+
+// Thread-safe B+Tree using optimistic lock coupling (Leis et al., "The ART of Practical Synchronization")
+// Every node has a version word, odd while a writer holds the node. Readers take no locks: they note a
+// node's version, read it, and check the version has not moved before trusting what they read - if it
+// has, the operation restarts from the root. Writers latch only the nodes they change: the leaf, or a
+// full node and its parent while splitting it
+// As in BTree, full nodes are split on the way down, so a split never has to climb back up the tree
+// Removes leave underfull leaves in place rather than merging, so nodes are only ever freed by the
+// destructor - readers can hold on to any node pointer without a memory reclamation scheme
+// Keys are read while writers may be changing them, so they have to be trivially copyable
+template <typename T, std::size_t N, typename Compare = std::less<T>>
+requires (N > 1) && std::is_trivially_copyable_v<T>
+class ConcurrentBTree
+{
+public:
+    // Constructor
+    ConcurrentBTree() : root(new Node(true)) {}
+
+    // Destructor
+    ~ConcurrentBTree()
+    {
+        std::stack<Node *> st;
+        st.push(root.load(std::memory_order_relaxed));
+
+        while (!st.empty())
+        {
+            Node *top = st.top();
+            st.pop();
+
+            if (top->leaf)
+                delete top;
+            else
+            {
+                Inner *in = static_cast<Inner *>(top);
+                for (int i = 0; i <= in->count; i++)
+                    st.push(in->children[i]);
+                delete in;
+            }
+        }
+    }
+
+    // Nodes are shared with concurrent readers, so the tree stays where it was built
+    ConcurrentBTree(const ConcurrentBTree &) = delete;
+    ConcurrentBTree &operator=(const ConcurrentBTree &) = delete;
+
+    // Search
+    bool find(const T &val) const
+    {
+        for (Backoff backoff;; backoff())
+        {
+            std::uint64_t version;
+            const Node *leaf = find_leaf(val, version);
+            if (leaf == nullptr)
+                continue;
+
+            int pos = lower_bound(leaf, val);
+            bool found = pos < load(leaf->count) && !is_less(less_than, val, load(leaf->keys[pos]));
+            if (validate(leaf, version))
+                return found;
+        }
+    }
+
+    // Insert
+    bool add(const T &val)
+    {
+        for (Backoff backoff;; backoff())
+        {
+            bool added;
+            if (try_add(val, added))
+                return added;
+        }
+    }
+
+    // Delete
+    bool remove(const T &val)
+    {
+        for (Backoff backoff;; backoff())
+        {
+            std::uint64_t version;
+            Node *leaf = find_leaf(val, version);
+            if (leaf == nullptr || !upgrade(leaf, version))
+                continue;
+
+            int pos = lower_bound(leaf, val);
+            if (pos == leaf->count || is_less(less_than, val, leaf->keys[pos]))
+            {
+                write_unlock(leaf);
+                return false;
+            }
+
+            for (int i = pos + 1; i < leaf->count; i++)
+                store(leaf->keys[i - 1], leaf->keys[i]);
+            store(leaf->count, leaf->count - 1);
+            write_unlock(leaf);
+            return true;
+        }
+    }
+
+private: // Node layout
+    static constexpr int CAPACITY = 2 * N - 1;
+
+    struct Node
+    {
+        std::atomic<std::uint64_t> version{0};
+        int count = 0;
+        const bool leaf;
+        alignas(std::atomic_ref<T>::required_alignment) T keys[CAPACITY];
+
+        explicit Node(bool leaf) : leaf(leaf) {}
+    };
+
+    // Child i holds the keys in (keys[i - 1], keys[i]]
+    struct Inner : Node
+    {
+        Node *children[CAPACITY + 1] = {nullptr};
+
+        Inner() : Node(false) {}
+    };
+
+private: // Attributes
+    std::atomic<Node *> root;
+    Compare less_than;
+
+private: // Methods
+    // Fields of a node may change under a reader, so every access outside a latch is a relaxed atomic
+    template <typename V>
+    static V load(const V &field)
+    {
+        return std::atomic_ref<V>(const_cast<V &>(field)).load(std::memory_order_relaxed);
+    }
+
+    template <typename V>
+    static void store(V &field, V value)
+    {
+        std::atomic_ref<V>(field).store(value, std::memory_order_relaxed);
+    }
+
+    static Node **children(Node *node)
+    {
+        return static_cast<Inner *>(node)->children;
+    }
+
+    static Node *const *children(const Node *node)
+    {
+        return static_cast<const Inner *>(node)->children;
+    }
+
+    // Notes the version of a node no writer holds - false if one does
+    static bool read_lock(const Node *node, std::uint64_t &version)
+    {
+        version = node->version.load(std::memory_order_acquire);
+        return (version & 1) == 0;
+    }
+
+    // True if the node has not been written since version was read, so everything read from it since is valid
+    static bool validate(const Node *node, std::uint64_t version)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return node->version.load(std::memory_order_relaxed) == version;
+    }
+
+    // Latches a node read at version - fails if it was written in the meantime
+    // The fence keeps the writer's stores after the odd version, as in a seqlock: a reader that sees any of
+    // them also sees the node latched, or a newer version, and fails its validation
+    static bool upgrade(Node *node, std::uint64_t &version)
+    {
+        if (!node->version.compare_exchange_strong(version, version + 1, std::memory_order_acquire))
+            return false;
+        std::atomic_thread_fence(std::memory_order_release);
+        version++;
+        return true;
+    }
+
+    static void write_unlock(Node *node)
+    {
+        node->version.fetch_add(1, std::memory_order_release);
+    }
+
+    // First position whose key is not less than val - the count is clamped, since a reader may see
+    // a value that is being changed
+    int lower_bound(const Node *node, const T &val) const
+    {
+        int l = 0, r = std::clamp(load(node->count), 0, CAPACITY);
+
+        while (l < r)
+        {
+            int m = (l + r) / 2;
+            if (is_less(less_than, load(node->keys[m]), val))
+                l = m + 1;
+            else
+                r = m;
+        }
+
+        return l;
+    }
+
+    // Optimistic descent to the leaf that covers val - nullptr if it has to restart
+    // The parent is validated again once the child's version is noted: a split of the child latches the
+    // parent too, so a child version read before the split shows up as a changed child later, and one read
+    // after it as a changed parent now - without the second check a reader could note the version of a
+    // freshly split left half and search it for a key that moved right
+    Node *find_leaf(const T &val, std::uint64_t &version) const
+    {
+        Node *node = root.load(std::memory_order_acquire);
+        if (!read_lock(node, version) || node != root.load(std::memory_order_acquire))
+            return nullptr;
+
+        while (!node->leaf)
+        {
+            Node *parent = node;
+            std::uint64_t parent_version = version;
+            node = load(children(parent)[lower_bound(parent, val)]);
+            if (!validate(parent, parent_version) || !read_lock(node, version) || !validate(parent, parent_version))
+                return nullptr;
+        }
+
+        return node;
+    }
+
+    // One insert attempt - false means it ran into a writer and has to restart
+    bool try_add(const T &val, bool &added)
+    {
+        Node *node = root.load(std::memory_order_acquire), *parent = nullptr;
+        std::uint64_t version, parent_version = 0;
+        if (!read_lock(node, version) || node != root.load(std::memory_order_acquire))
+            return false;
+
+        while (true)
+        {
+            // Full - latch the node and its parent, split, and start over from the root
+            if (load(node->count) == CAPACITY)
+            {
+                if (parent && !upgrade(parent, parent_version))
+                    return false;
+                if (!upgrade(node, version))
+                {
+                    if (parent)
+                        write_unlock(parent);
+                    return false;
+                }
+
+                // Somebody grew a new root above this one
+                if (!parent && node != root.load(std::memory_order_acquire))
+                {
+                    write_unlock(node);
+                    return false;
+                }
+
+                split(node, parent);
+                write_unlock(node);
+                if (parent)
+                    write_unlock(parent);
+                return false;
+            }
+
+            if (node->leaf)
+                break;
+
+            if (parent && !validate(parent, parent_version))
+                return false;
+
+            parent = node;
+            parent_version = version;
+            node = load(children(node)[lower_bound(node, val)]);
+            if (!validate(parent, parent_version) || !read_lock(node, version))
+                return false;
+        }
+
+        if (!upgrade(node, version))
+            return false;
+        if (parent && !validate(parent, parent_version))
+        {
+            write_unlock(node);
+            return false;
+        }
+
+        int pos = lower_bound(node, val);
+        added = pos == node->count || is_less(less_than, val, node->keys[pos]);
+        if (added)
+        {
+            for (int i = node->count; i > pos; i--)
+                store(node->keys[i], node->keys[i - 1]);
+            store(node->keys[pos], val);
+            store(node->count, node->count + 1);
+        }
+
+        write_unlock(node);
+        return true;
+    }
+
+    // Splits a full, latched node into two halves - the separator goes into the latched parent,
+    // or into a new root when the node was the root
+    void split(Node *node, Node *parent)
+    {
+        Node *right;
+        T separator;
+
+        if (node->leaf)
+        {
+            // Left keeps N keys, the largest of which separates the halves
+            right = new Node(true);
+            for (int i = N; i < CAPACITY; i++)
+                right->keys[i - N] = node->keys[i];
+            right->count = N - 1;
+            separator = node->keys[N - 1];
+            store(node->count, static_cast<int>(N));
+        }
+
+        else
+        {
+            // The middle key moves up, N - 1 keys and N children stay on each side
+            right = new Inner;
+            for (int i = N; i < CAPACITY; i++)
+                right->keys[i - N] = node->keys[i];
+            for (int i = N; i <= CAPACITY; i++)
+                children(right)[i - N] = children(node)[i];
+            right->count = N - 1;
+            separator = node->keys[N - 1];
+            store(node->count, static_cast<int>(N - 1));
+        }
+
+        if (parent == nullptr)
+        {
+            Inner *new_root = new Inner;
+            new_root->keys[0] = separator;
+            new_root->children[0] = node;
+            new_root->children[1] = right;
+            new_root->count = 1;
+            root.store(new_root, std::memory_order_release);
+            return;
+        }
+
+        int pos = lower_bound(parent, separator);
+        for (int i = parent->count; i > pos; i--)
+        {
+            store(parent->keys[i], parent->keys[i - 1]);
+            store(children(parent)[i + 1], children(parent)[i]);
+        }
+        store(parent->keys[pos], separator);
+        // Release, so a reader that finds right also finds the keys written into it above
+        std::atomic_ref<Node *>(children(parent)[pos + 1]).store(right, std::memory_order_release);
+        store(parent->count, parent->count + 1);
+    }
+
+private:
+    friend class ConcurrentBTreeTester;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "btree.h"
+#include "bplustree.h"
+#include "concurrent_btree.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
@@ -6,6 +8,11 @@
 #include <cassert>
 #include <set>
 #include <numeric>
+#include <string>
+#include <span>
+#include <memory>
+#include <thread>
+#include <atomic>
 
 class BTreeTester
 {
@@ -133,6 +140,52 @@ public:
         std::cout << "Passed Random" << std::endl;
     }
 
+    // Mixed operations through a three-way comparator and through a bool comparator other than std::less
+    template <std::size_t N>
+    static void comparatorTest(size_t samples = 20000)
+    {
+        BTree<std::string, N, std::compare_three_way> strings;
+        BTree<int, N, std::greater<int>> reversed;
+        std::set<int> model;
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> dist(0, 2000);
+        auto key = [](int val) { return std::string(40, 'k') + std::to_string(val); };
+
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int val = dist(gen);
+            switch (gen() % 3)
+            {
+            case 0:
+            {
+                bool added = model.insert(val).second;
+                assert(strings.add(key(val)) == added);
+                assert(reversed.add(val) == added);
+                break;
+            }
+            case 1:
+                assert(strings.find(key(val)) == model.contains(val));
+                assert(reversed.find(val) == model.contains(val));
+                break;
+            default:
+            {
+                bool erased = model.erase(val) > 0;
+                assert(strings.remove(key(val)) == erased);
+                assert(reversed.remove(val) == erased);
+                break;
+            }
+            }
+        }
+
+        for (int val = 0; val <= 2000; ++val)
+        {
+            assert(strings.find(key(val)) == model.contains(val));
+            assert(reversed.find(val) == model.contains(val));
+        }
+
+        std::cout << "Passed Comparators" << std::endl;
+    }
+
     template <typename T, std::size_t N>
     static void structureTest()
     {
@@ -146,7 +199,196 @@ public:
         std::cout << "Passed structure" << std::endl;
     }
 
+    template <typename T, std::size_t N>
+    static void fromSortedTest(size_t max_volume = 600)
+    {
+        for (size_t volume = 0; volume <= max_volume; volume += volume < 100 ? 1 : 37)
+        {
+            std::vector<T> values(volume);
+            std::iota(values.begin(), values.end(), 0);
+
+            BTree<T, N> tree = BTree<T, N>::from_sorted(values.begin(), values.end());
+            validateBalanced<T, N>(tree.root);
+            for (const T &val : values)
+                assert(tree.find(val));
+            assert(!tree.find(static_cast<T>(volume)));
+
+            // Still a working tree afterwards
+            assert(tree.add(static_cast<T>(volume)));
+            for (const T &val : values)
+                assert(tree.remove(val));
+            assert(tree.remove(static_cast<T>(volume)));
+            assert(tree.root == nullptr);
+        }
+
+        std::cout << "Passed From Sorted" << std::endl;
+    }
+
+    template <typename T, std::size_t N>
+    static void memoryUsageTest(size_t volume = 10'000)
+    {
+        BTree<T, N> tree;
+        assert(tree.memory_usage().bytes == 0);
+
+        for (size_t i = 0; i < volume; ++i)
+            tree.add(static_cast<T>(i));
+
+        // Leaves carry no child array, and at the default fill nearly every node is a leaf
+        auto usage = tree.memory_usage();
+        assert(usage.keys == volume);
+        assert(usage.bytes == usage.leaves * sizeof(typename BTree<T, N>::Node) + usage.internals * sizeof(typename BTree<T, N>::Internal));
+        assert(usage.leaves > usage.internals);
+        assert(usage.nodes == usage.leaves + usage.internals);
+        assert(usage.fill > 0.4 && usage.fill <= 1.0);
+        assert(usage.bytes_per_key() == static_cast<double>(usage.bytes) / volume);
+
+        for (size_t i = 0; i < volume; ++i)
+            assert(tree.remove(static_cast<T>(i)));
+        assert(tree.memory_usage().bytes == 0);
+
+        std::cout << "Passed Memory Usage" << std::endl;
+    }
+
+    // find_batch must agree with find for every batch length, including partial and empty groups
+    template <typename Tree>
+    static void checkFindBatch(const Tree &tree, const std::set<int> &model, std::mt19937 &gen)
+    {
+        checkLookups(model, gen, [&](std::span<const int> keys, std::span<bool> out) { tree.find_batch(keys, out); });
+    }
+
+    template <typename Lookup>
+    static void checkLookups(const std::set<int> &model, std::mt19937 &gen, Lookup lookup)
+    {
+        std::uniform_int_distribution<int> dist(0, 2 * static_cast<int>(model.size()) + 10);
+        for (std::size_t length : {0, 1, 15, 16, 17, 1000})
+        {
+            std::vector<int> keys(length);
+            for (int &key : keys)
+                key = dist(gen);
+            std::unique_ptr<bool[]> out(new bool[length + 1]);
+            lookup(std::span<const int>(keys), std::span<bool>(out.get(), length));
+            for (std::size_t i = 0; i < length; i++)
+                assert(out[i] == model.contains(keys[i]));
+        }
+    }
+
+    template <std::size_t N, typename Compare = std::less<int>>
+    static void findBatchTest()
+    {
+        std::mt19937 gen(7);
+        BTree<int, N, Compare> tree;
+        std::set<int> model;
+        checkFindBatch(tree, model, gen);
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            int val = gen() % 10000;
+            tree.add(val);
+            model.insert(val);
+        }
+        checkFindBatch(tree, model, gen);
+
+        // Coroutine lookups, from one task at a time to more than the scheduler's slots
+        for (std::size_t in_flight : {1, 3, 16, 1000})
+            checkLookups(model, gen, [&](std::span<const int> keys, std::span<bool> out) { tree.find_interleaved(keys, out, in_flight); });
+
+        std::cout << "Passed Find Batch" << std::endl;
+    }
+
+    template <std::size_t N>
+    static void statsTest()
+    {
+        BTree<int, N, std::less<int>, TreeStats> tree;
+        for (int i = 0; i < static_cast<int>(2 * N - 1); ++i)
+            tree.add(i);
+        assert(tree.stats().splits == 0);
+
+        // The root is full, so the next insert splits it
+        tree.add(2 * N - 1);
+        assert(tree.stats().splits == 1);
+
+        for (int i = 2 * N; i < 1000; ++i)
+            tree.add(i);
+        tree.reset_stats();
+        for (int i = 0; i < 1000; ++i)
+            assert(tree.remove(i));
+        assert(tree.stats().merges > 0 && tree.stats().borrows > 0 && tree.stats().splits == 0);
+
+        // The vectorised rank makes no comparator calls; a custom comparator takes the scalar path
+        assert(tree.stats().comparisons == 0 && tree.stats().visits > 0);
+        BTree<int, N, std::greater<int>, TreeStats> scalar;
+        for (int i = 0; i < 100; ++i)
+            scalar.add(i);
+        scalar.reset_stats();
+        assert(scalar.find(50));
+        assert(scalar.stats().comparisons >= scalar.stats().visits);
+
+        std::cout << "Passed Stats" << std::endl;
+    }
+
+    template <typename T, std::size_t N>
+    static void simdSearchTest(size_t rounds = 2000)
+    {
+        // Compare the vectorised rank kernel with the scalar binary search on random sorted nodes
+        static_assert(BTree<T, N>::simd_search);
+        BTree<T, N> tree;
+        typename BTree<T, N>::Node node(true);
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<int> dist(-100, 100);
+
+        for (size_t r = 0; r < rounds; ++r)
+        {
+            std::set<T> keys;
+            int count = std::uniform_int_distribution<int>(0, 2 * N - 1)(gen);
+            while (static_cast<int>(keys.size()) < count)
+                keys.insert(static_cast<T>(dist(gen)));
+
+            node.num_keys = 0;
+            for (const T &key : keys)
+                node.keys[node.num_keys++] = key;
+
+            T val = static_cast<T>(dist(gen));
+            int expected = static_cast<int>(std::distance(keys.begin(), keys.upper_bound(val))) - 1;
+            bool found;
+            assert(tree.bin_search(&node, val, found) == expected);
+            assert(found == keys.contains(val));
+        }
+
+        std::cout << "Passed SIMD search" << std::endl;
+    }
+
 private:
+    // Full B-Tree invariants - occupancy bounds, sorted keys within separator bounds and all leaves at one depth
+    template <typename T, std::size_t N>
+    static void validateBalanced(typename BTree<T, N>::Node *root)
+    {
+        int leaf_depth = -1;
+        auto walk = [&](auto walk, typename BTree<T, N>::Node *node, const T *lo, const T *hi, int depth) -> void
+        {
+            assert(node->num_keys <= static_cast<int>(2 * N - 1));
+            assert(node == root ? node->num_keys >= 1 : node->num_keys >= static_cast<int>(N - 1));
+            for (int i = 0; i < node->num_keys; ++i)
+            {
+                assert(i == 0 || node->keys[i - 1] < node->keys[i]);
+                assert((!lo || *lo < node->keys[i]) && (!hi || node->keys[i] < *hi));
+            }
+
+            if (node->leaf)
+            {
+                assert(leaf_depth == -1 || leaf_depth == depth);
+                leaf_depth = depth;
+                return;
+            }
+
+            auto *internal = static_cast<typename BTree<T, N>::Internal *>(node);
+            for (int i = 0; i <= node->num_keys; ++i)
+                walk(walk, internal->children[i], i == 0 ? lo : &node->keys[i - 1], i == node->num_keys ? hi : &node->keys[i], depth + 1);
+        };
+
+        if (root)
+            walk(walk, root, nullptr, nullptr, 0);
+    }
+
     template <typename T, std::size_t N>
     static void validateNode(typename BTree<T, N>::Node *node)
     {
@@ -156,10 +398,11 @@ private:
         assert(node->num_keys <= static_cast<int>(2 * N - 1));
         if (!node->leaf)
         {
+            auto *internal = static_cast<typename BTree<T, N>::Internal *>(node);
             for (int i = 0; i <= node->num_keys; ++i)
             {
-                assert(node->children[i] != nullptr);
-                validateNode<T, N>(node->children[i]);
+                assert(internal->children[i] != nullptr);
+                validateNode<T, N>(internal->children[i]);
             }
         }
         for (int i = 1; i < node->num_keys; ++i)
@@ -169,6 +412,379 @@ private:
     }
 };
 
+class BPlusTreeTester
+{
+public:
+    template <typename T, std::size_t N>
+    static void basicOperationsTest()
+    {
+        BPlusTree<T, N> tree;
+
+        std::vector<T> data = {13, 10, 7, 6, 17, 15, 2, 9, 21, 1};
+        for (const auto &val : data)
+        {
+            assert(tree.add(val));
+            assert(!tree.add(val));
+            assert(tree.find(val));
+            validate(tree);
+        }
+
+        for (const auto &val : data)
+        {
+            assert(tree.remove(val));
+            assert(!tree.remove(val));
+            assert(!tree.find(val));
+            validate(tree);
+        }
+        assert(tree.root == nullptr);
+
+        std::cout << "Passed B+ Basic" << std::endl;
+    }
+
+    template <typename T, std::size_t N>
+    static void copyMoveTest()
+    {
+        BPlusTree<T, N> original;
+        for (T val = 0; val < 100; val++)
+            original.add(val);
+
+        BPlusTree<T, N> copied = original;
+        validate(copied);
+        assert(std::equal(copied.begin(), copied.end(), original.begin(), original.end()));
+        copied.remove(50);
+        assert(original.find(50) && !copied.find(50));
+
+        BPlusTree<T, N> moved = std::move(original);
+        assert(original.root == nullptr && moved.find(50));
+
+        BPlusTree<T, N> assigned;
+        assigned.add(1000);
+        assigned = copied;
+        assert(!assigned.find(1000) && !assigned.find(50) && assigned.find(49));
+
+        std::cout << "Passed B+ Copy - Move" << std::endl;
+    }
+
+    template <typename T, std::size_t N>
+    static void randomTest(size_t samples = 20000)
+    {
+        BPlusTree<T, N> tree;
+        std::set<T> model;
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<T> dist(1, 5000);
+
+        for (size_t i = 0; i < samples; ++i)
+        {
+            T val = dist(gen);
+            switch (gen() % 3)
+            {
+            case 0:
+                assert(tree.add(val) == model.insert(val).second);
+                break;
+            case 1:
+                assert(tree.find(val) == model.contains(val));
+                break;
+            default:
+                assert(tree.remove(val) == (model.erase(val) > 0));
+                break;
+            }
+
+            if (i % 1000 == 0)
+                validate(tree);
+        }
+
+        validate(tree);
+        assert(std::equal(tree.begin(), tree.end(), model.begin(), model.end()));
+
+        for (T val : model)
+            assert(tree.remove(val));
+        assert(tree.root == nullptr);
+
+        std::cout << "Passed B+ Random" << std::endl;
+    }
+
+    template <std::size_t N>
+    static void findBatchTest()
+    {
+        std::mt19937 gen(11);
+        BPlusTree<int, N> tree;
+        std::set<int> model;
+        BTreeTester::checkFindBatch(tree, model, gen);
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            int val = gen() % 10000;
+            tree.add(val);
+            model.insert(val);
+        }
+        BTreeTester::checkFindBatch(tree, model, gen);
+
+        std::cout << "Passed B+ Find Batch" << std::endl;
+    }
+
+    template <typename T, std::size_t N>
+    static void rangeTest(size_t volume = 10'000)
+    {
+        BPlusTree<T, N> tree;
+        std::set<T> model;
+        std::vector<T> values(volume);
+        std::iota(values.begin(), values.end(), 0);
+        std::shuffle(values.begin(), values.end(), std::mt19937{std::random_device{}()});
+
+        // Only even keys, so range bounds fall on both present and absent keys
+        for (const T &val : values)
+        {
+            tree.add(2 * val);
+            model.insert(2 * val);
+        }
+
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<T> dist(-10, 2 * volume + 10);
+        for (int i = 0; i < 200; i++)
+        {
+            T lo = dist(gen), hi = dist(gen);
+            std::vector<T> got, expected;
+            for (const T &val : tree.range(lo, hi))
+                got.push_back(val);
+            if (lo < hi)
+                expected.assign(model.lower_bound(lo), model.lower_bound(hi));
+            assert(got == expected);
+        }
+
+        assert(tree.range(5, 5).begin() == tree.range(5, 5).end());
+        assert(tree.lower_bound(2 * volume) == tree.end());
+        assert(*tree.lower_bound(-3) == 0);
+
+        std::cout << "Passed B+ Range" << std::endl;
+    }
+
+private:
+    // Checks key order, node occupancy, separator bounds, uniform leaf depth and the leaf chain
+    template <typename T, std::size_t N, typename Compare>
+    static void validate(const BPlusTree<T, N, Compare> &tree)
+    {
+        using Tree = BPlusTree<T, N, Compare>;
+        std::vector<const typename Tree::Leaf *> leaves;
+        int leaf_depth = -1;
+
+        auto walk = [&](auto walk, const typename Tree::Node *node, const T *lo, const T *hi, int depth) -> void
+        {
+            assert(node->num_keys <= static_cast<int>(2 * N - 1));
+            if (node != tree.root)
+                assert(node->num_keys >= static_cast<int>(N - 1));
+            for (int i = 0; i < node->num_keys; i++)
+            {
+                assert(i == 0 || node->keys[i - 1] < node->keys[i]);
+                assert(!lo || !(node->keys[i] < *lo));
+                assert(!hi || node->keys[i] < *hi);
+            }
+
+            if (node->leaf)
+            {
+                assert(leaf_depth == -1 || leaf_depth == depth);
+                leaf_depth = depth;
+                leaves.push_back(static_cast<const typename Tree::Leaf *>(node));
+                return;
+            }
+
+            const auto *in = static_cast<const typename Tree::Internal *>(node);
+            for (int i = 0; i <= in->num_keys; i++)
+                walk(walk, in->children[i], i == 0 ? lo : &in->keys[i - 1], i == in->num_keys ? hi : &in->keys[i], depth + 1);
+        };
+
+        if (tree.root == nullptr)
+            return;
+
+        walk(walk, tree.root, nullptr, nullptr, 0);
+        for (size_t i = 0; i < leaves.size(); i++)
+            assert(leaves[i]->next == (i + 1 < leaves.size() ? leaves[i + 1] : nullptr));
+    }
+};
+
+class ConcurrentBTreeTester
+{
+public:
+    // Single-threaded model check, small orders so splits reach several levels
+    template <std::size_t N>
+    static void randomTest(size_t samples = 50'000)
+    {
+        ConcurrentBTree<int, N> tree;
+        std::set<int> model;
+        std::mt19937 gen(5);
+        std::uniform_int_distribution<int> dist(0, 5000);
+
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int val = dist(gen);
+            switch (gen() % 3)
+            {
+            case 0:
+                assert(tree.add(val) == model.insert(val).second);
+                break;
+            case 1:
+                assert(tree.find(val) == model.contains(val));
+                break;
+            default:
+                assert(tree.remove(val) == (model.erase(val) > 0));
+                break;
+            }
+        }
+
+        assert(validate(tree) == model.size());
+        std::cout << "Passed Concurrent Random" << std::endl;
+    }
+
+    // Writers own disjoint keys (k % writers == t) and keep a private model of them, while readers look up
+    // a preloaded range nobody removes - every one of those lookups has to hit, whatever the writers split
+    template <std::size_t N>
+    static void stressTest(int writers = 4, int readers = 2, int ops = 50'000)
+    {
+        ConcurrentBTree<int, N> tree;
+        const int stable = 2000, range = 20000;
+        for (int i = 0; i < stable; ++i)
+            tree.add(-1 - i);
+
+        std::vector<std::set<int>> models(writers);
+        std::atomic<bool> done{false};
+        std::atomic<long> reader_misses{0};
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < writers; ++t)
+            threads.emplace_back([&, t]
+            {
+                std::mt19937 gen(100 + t);
+                for (int i = 0; i < ops; ++i)
+                {
+                    int val = static_cast<int>(gen() % (range / writers)) * writers + t;
+                    if (gen() % 3)
+                        assert(tree.add(val) == models[t].insert(val).second);
+                    else
+                        assert(tree.remove(val) == (models[t].erase(val) > 0));
+                }
+            });
+
+        for (int r = 0; r < readers; ++r)
+            threads.emplace_back([&, r]
+            {
+                std::mt19937 gen(200 + r);
+                while (!done.load(std::memory_order_relaxed))
+                    if (!tree.find(-1 - static_cast<int>(gen() % stable)))
+                        reader_misses++;
+            });
+
+        for (int t = 0; t < writers; ++t)
+            threads[t].join();
+        done = true;
+        for (std::size_t t = writers; t < threads.size(); ++t)
+            threads[t].join();
+
+        assert(reader_misses == 0);
+        std::size_t expected = stable;
+        for (int t = 0; t < writers; ++t)
+        {
+            expected += models[t].size();
+            for (int val = t; val < range; val += writers)
+                assert(tree.find(val) == models[t].contains(val));
+        }
+        assert(validate(tree) == expected);
+
+        std::cout << "Passed Concurrent Stress" << std::endl;
+    }
+
+    // Readers race splits of the very leaves they are looking in: a fresh, small-order tree per round holds
+    // a few keys nobody removes, spread across the range the writers fill in, so nearly every insert splits
+    // a node on some reader's path. A reader that trusts a child's version without rechecking the parent
+    // can land in the left half of a split leaf and miss a key that moved right
+    template <std::size_t N>
+    static void splitRaceTest(int writers = 3, int readers = 3, int rounds = 200)
+    {
+        const int stable = 64, spacing = 64;
+        long reader_misses = 0;
+
+        for (int round = 0; round < rounds; ++round)
+        {
+            ConcurrentBTree<int, N> tree;
+            for (int i = 0; i < stable; ++i)
+                tree.add(i * spacing);
+
+            std::atomic<int> running{writers};
+            std::atomic<long> misses{0};
+            std::vector<std::thread> threads;
+
+            for (int t = 0; t < writers; ++t)
+                threads.emplace_back([&, t]
+                {
+                    std::mt19937 gen(round * writers + t);
+                    for (int i = 0; i < stable * spacing; ++i)
+                    {
+                        int val = static_cast<int>(gen() % (stable * spacing));
+                        if (val % spacing)
+                            tree.add(val);
+                    }
+                    running--;
+                });
+
+            for (int r = 0; r < readers; ++r)
+                threads.emplace_back([&, r]
+                {
+                    std::mt19937 gen(round * readers + r + 1000);
+                    while (running.load(std::memory_order_relaxed) > 0)
+                        if (!tree.find(static_cast<int>(gen() % stable) * spacing))
+                            misses++;
+                });
+
+            for (std::thread &thread : threads)
+                thread.join();
+
+            reader_misses += misses;
+            assert(validate(tree) >= static_cast<std::size_t>(stable));
+            for (int i = 0; i < stable; ++i)
+                assert(tree.find(i * spacing));
+        }
+
+        assert(reader_misses == 0);
+        std::cout << "Passed Concurrent Split Race" << std::endl;
+    }
+
+private:
+    // Keys sorted and within their separators, counts within capacity, leaves all at one depth, no latch
+    // left held - returns the number of keys
+    template <typename T, std::size_t N>
+    static std::size_t validate(const ConcurrentBTree<T, N> &tree)
+    {
+        using Node = typename ConcurrentBTree<T, N>::Node;
+        int leaf_depth = -1;
+        std::size_t keys = 0;
+
+        auto walk = [&](auto walk, const Node *node, const T *lo, const T *hi, int depth) -> void
+        {
+            assert((node->version.load() & 1) == 0);
+            assert((node->count >= 0 && node->count <= ConcurrentBTree<T, N>::CAPACITY));
+            for (int i = 0; i < node->count; i++)
+            {
+                assert(i == 0 || node->keys[i - 1] < node->keys[i]);
+                assert(lo == nullptr || *lo < node->keys[i]);
+                assert(hi == nullptr || node->keys[i] <= *hi);
+            }
+
+            if (node->leaf)
+            {
+                assert(leaf_depth == -1 || leaf_depth == depth);
+                leaf_depth = depth;
+                keys += node->count;
+                return;
+            }
+
+            assert(node->count > 0);
+            for (int i = 0; i <= node->count; i++)
+                walk(walk, ConcurrentBTree<T, N>::children(node)[i], i == 0 ? lo : &node->keys[i - 1], i == node->count ? hi : &node->keys[i], depth + 1);
+        };
+
+        walk(walk, tree.root.load(), nullptr, nullptr, 0);
+        return keys;
+    }
+};
+
 int main(int argc, char const *argv[])
 {
     std::cout << "Running BTree tests..." << std::endl;
@@ -180,6 +796,34 @@ int main(int argc, char const *argv[])
     BTreeTester::largeVolumeTest<int, 8>();
     BTreeTester::randomTest<int, 4>();
     BTreeTester::structureTest<int, 3>();
+    BTreeTester::comparatorTest<3>();
+    BTreeTester::fromSortedTest<int, 2>();
+    BTreeTester::fromSortedTest<int, 3>();
+    BTreeTester::fromSortedTest<int, 16>();
+    BTreeTester::memoryUsageTest<int, 16>();
+    BTreeTester::statsTest<3>();
+    BTreeTester::findBatchTest<3>();
+    BTreeTester::findBatchTest<16>();
+    BTreeTester::findBatchTest<4, std::greater<int>>();
+    BTreeTester::simdSearchTest<int, 16>();
+    BTreeTester::simdSearchTest<unsigned, 16>();
+    BTreeTester::simdSearchTest<long long, 16>();
+    BTreeTester::simdSearchTest<unsigned long long, 5>();
+    BTreeTester::simdSearchTest<float, 16>();
+    BTreeTester::simdSearchTest<double, 7>();
+    BTreeTester::simdSearchTest<short, 4>();
+    BPlusTreeTester::basicOperationsTest<int, 2>();
+    BPlusTreeTester::copyMoveTest<int, 3>();
+    BPlusTreeTester::randomTest<int, 2>();
+    BPlusTreeTester::randomTest<int, 5>();
+    BPlusTreeTester::rangeTest<int, 4>();
+    BPlusTreeTester::findBatchTest<2>();
+    BPlusTreeTester::findBatchTest<16>();
+    ConcurrentBTreeTester::randomTest<2>();
+    ConcurrentBTreeTester::randomTest<16>();
+    ConcurrentBTreeTester::stressTest<2>();
+    ConcurrentBTreeTester::stressTest<16>();
+    ConcurrentBTreeTester::splitRaceTest<2>();
     #endif
     #ifdef TIME
     BTreeTester::randomTest<int, 20>(1'000'000);
@@ -0,0 +1,109 @@
+#ifndef __NODE_SEARCH_H__
+#define __NODE_SEARCH_H__
+
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <bit>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Arithmetic keys under the default ordering can be ranked with the vectorised kernel below
+template <typename T, typename Compare>
+inline constexpr bool simd_searchable = std::is_arithmetic_v<T> && (std::is_same_v<Compare, std::less<T>> || std::is_same_v<Compare, std::less<>>);
+
+// Number of keys <= val - compares a full register of keys per step and stops at the first key > val
+template <typename T>
+inline int simd_rank(const T *keys, int n, T val)
+{
+    int i = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_integral_v<T> && sizeof(T) == 4)
+    {
+        // Unsigned keys are biased into signed range so the signed compare orders them correctly
+        const __m256i bias = _mm256_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+        const __m256i v = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(val)), bias);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i k = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)), bias);
+            if (int gt = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+        }
+    }
+    else if constexpr (std::is_integral_v<T> && sizeof(T) == 8)
+    {
+        const __m256i bias = _mm256_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+        const __m256i v = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(val)), bias);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256i k = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)), bias);
+            if (int gt = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v))))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+        }
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        const __m256 v = _mm256_set1_ps(val);
+        for (; i + 8 <= n; i += 8)
+            if (int gt = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(keys + i), v, _CMP_GT_OQ)))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        const __m256d v = _mm256_set1_pd(val);
+        for (; i + 4 <= n; i += 4)
+            if (int gt = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(keys + i), v, _CMP_GT_OQ)))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+    }
+#elif defined(__SSE2__)
+    if constexpr (std::is_integral_v<T> && sizeof(T) == 4)
+    {
+        const __m128i bias = _mm_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+        const __m128i v = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(val)), bias);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i k = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i)), bias);
+            if (int gt = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v))))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+        }
+    }
+#if defined(__SSE4_2__)
+    else if constexpr (std::is_integral_v<T> && sizeof(T) == 8)
+    {
+        const __m128i bias = _mm_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+        const __m128i v = _mm_xor_si128(_mm_set1_epi64x(static_cast<int64_t>(val)), bias);
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128i k = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i)), bias);
+            if (int gt = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(k, v))))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+        }
+    }
+#endif
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        const __m128 v = _mm_set1_ps(val);
+        for (; i + 4 <= n; i += 4)
+            if (int gt = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(keys + i), v)))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        const __m128d v = _mm_set1_pd(val);
+        for (; i + 2 <= n; i += 2)
+            if (int gt = _mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(keys + i), v)))
+                return i + std::countr_zero(static_cast<unsigned>(gt));
+    }
+#endif
+
+    // Scalar tail (and fallback) - branchless count, the keys are sorted so this is the rank
+    int rank = i;
+    for (; i < n; i++)
+        rank += !(val < keys[i]);
+    return rank;
+}
+
+#endif
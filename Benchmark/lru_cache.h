@@ -0,0 +1,76 @@
+#ifndef __LRU_CACHE_H__
+#define __LRU_CACHE_H__
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// The textbook LRU cache - a hash map into a recency list - as the baseline for SplayCache
+// Same interface: get returns the value or nullptr, put inserts or overwrites and evicts the least
+// recently used key when full
+template <typename K, typename V>
+class LruCache
+{
+public:
+    explicit LruCache(std::size_t capacity) : max_entries(capacity > 0 ? capacity : 1)
+    {
+        index.reserve(max_entries);
+    }
+
+    V *get(const K &key)
+    {
+        auto it = index.find(key);
+        if (it == index.end())
+        {
+            miss_count++;
+            return nullptr;
+        }
+
+        hit_count++;
+        order.splice(order.begin(), order, it->second);
+        return &it->second->second;
+    }
+
+    bool put(const K &key, V value)
+    {
+        auto it = index.find(key);
+        if (it != index.end())
+        {
+            it->second->second = std::move(value);
+            order.splice(order.begin(), order, it->second);
+            return false;
+        }
+
+        if (index.size() == max_entries)
+        {
+            index.erase(order.back().first);
+            order.pop_back();
+            eviction_count++;
+        }
+
+        order.emplace_front(key, std::move(value));
+        index.emplace(key, order.begin());
+        return true;
+    }
+
+    std::size_t size() const { return index.size(); }
+    std::uint64_t hits() const { return hit_count; }
+    std::uint64_t misses() const { return miss_count; }
+    std::uint64_t evictions() const { return eviction_count; }
+
+    double hit_ratio() const
+    {
+        std::uint64_t total = hit_count + miss_count;
+        return total ? static_cast<double>(hit_count) / total : 0;
+    }
+
+private:
+    std::size_t max_entries;
+    std::list<std::pair<K, V>> order; // Most recently used first
+    std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> index;
+    std::uint64_t hit_count = 0, miss_count = 0, eviction_count = 0;
+};
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+#include <vector>
+#include <string>
+#include <map>
+#include <tuple>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <ctime>
+#include <thread>
+#include <algorithm>
+
+// Machine-readable benchmark results (CSV / JSON) and the regression check that compares two result files
+
+struct Measurement
+{
+    std::string suite;   // Table the value belongs to, e.g. "random" or "latency"
+    std::string subject; // Tree (and variant) that was measured
+    std::string metric;  // Column, e.g. "insert" or "find_hit.p99"
+    std::string unit;    // ms, ns, Mops/s, ... - also decides whether higher or lower is better
+    long long size;      // Element count of the run
+    int repetition;
+    double value;
+};
+
+// Throughputs, speed-ups and node fill improve upwards, everything else (times, bytes, events) downwards
+inline bool higher_is_better(const std::string &unit)
+{
+    return unit == "x" || unit == "fill" || unit == "hit ratio" || (unit.size() > 2 && unit.ends_with("/s"));
+}
+
+class BenchmarkReport
+{
+public:
+    // Stamped onto every measurement added until changed
+    int repetition = 0;
+    long long size = 0;
+
+    void set(const std::string &key, const std::string &value)
+    {
+        auto it = std::ranges::find(environment, key, &std::pair<std::string, std::string>::first);
+        if (it != environment.end())
+            it->second = value;
+        else
+            environment.emplace_back(key, value);
+    }
+
+    void add(const std::string &suite, const std::string &subject, const std::string &metric, const std::string &unit, double value)
+    {
+        results.push_back({suite, subject, metric, unit, size, repetition, value});
+    }
+
+    const std::vector<Measurement> &measurements() const { return results; }
+
+    // Environment as leading "# key=value" comment lines, then one row per measurement
+    bool write_csv(const std::string &path) const
+    {
+        std::ofstream out(path);
+        for (const auto &[key, value] : environment)
+            out << "# " << key << "=" << value << "\n";
+        out << "suite,subject,metric,unit,size,repetition,value\n";
+        out << std::setprecision(17);
+        for (const Measurement &m : results)
+            out << csv_field(m.suite) << "," << csv_field(m.subject) << "," << csv_field(m.metric) << "," << csv_field(m.unit) << ","
+                << m.size << "," << m.repetition << "," << m.value << "\n";
+        return static_cast<bool>(out);
+    }
+
+    bool write_json(const std::string &path) const
+    {
+        std::ofstream out(path);
+        out << "{\n  \"environment\": {";
+        for (std::size_t i = 0; i < environment.size(); ++i)
+            out << (i ? ",\n    " : "\n    ") << json_string(environment[i].first) << ": " << json_string(environment[i].second);
+        out << "\n  },\n  \"results\": [";
+        out << std::setprecision(17);
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Measurement &m = results[i];
+            out << (i ? ",\n    " : "\n    ") << "{\"suite\": " << json_string(m.suite) << ", \"subject\": " << json_string(m.subject)
+                << ", \"metric\": " << json_string(m.metric) << ", \"unit\": " << json_string(m.unit) << ", \"size\": " << m.size
+                << ", \"repetition\": " << m.repetition << ", \"value\": " << (std::isfinite(m.value) ? m.value : 0.0) << "}";
+        }
+        out << "\n  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    // Rows of a file written by write_csv; false if it cannot be read or is malformed
+    static bool read_csv(const std::string &path, std::vector<Measurement> &rows)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+
+        std::string line;
+        bool header = true;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            if (header)
+            {
+                header = false;
+                continue;
+            }
+
+            std::vector<std::string> fields = split_csv(line);
+            if (fields.size() != 7)
+                return false;
+            try
+            {
+                rows.push_back({fields[0], fields[1], fields[2], fields[3], std::stoll(fields[4]), std::stoi(fields[5]), std::stod(fields[6])});
+            }
+            catch (const std::exception &)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> environment;
+    std::vector<Measurement> results;
+
+    static std::string csv_field(const std::string &field)
+    {
+        if (field.find_first_of(",\"\n") == std::string::npos)
+            return field;
+
+        std::string quoted = "\"";
+        for (char c : field)
+            quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+        return quoted + "\"";
+    }
+
+    static std::vector<std::string> split_csv(const std::string &line)
+    {
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (std::size_t i = 0; i < line.size(); ++i)
+        {
+            char c = line[i];
+            if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                fields.back() += line[++i];
+            else if (c == '"')
+                quoted = !quoted;
+            else if (c == ',' && !quoted)
+                fields.emplace_back();
+            else
+                fields.back() += c;
+        }
+        return fields;
+    }
+
+    static std::string json_string(const std::string &text)
+    {
+        std::ostringstream out;
+        out << '"';
+        for (unsigned char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (c < 0x20)
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+            else
+                out << c;
+        }
+        out << '"';
+        return out.str();
+    }
+};
+
+// Compiler, build flags, CPU and time of the run - BENCH_FLAGS is passed in by the Makefile
+inline void record_environment(BenchmarkReport &report)
+{
+#if defined(__clang__)
+    report.set("compiler", std::string("clang ") + __clang_version__);
+#elif defined(__GNUC__)
+    report.set("compiler", std::string("gcc ") + __VERSION__);
+#else
+    report.set("compiler", "unknown");
+#endif
+
+#ifdef BENCH_FLAGS
+    report.set("flags", BENCH_FLAGS);
+#else
+    report.set("flags", "unknown");
+#endif
+
+    std::string cpu = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);)
+        if (line.starts_with("model name"))
+        {
+            cpu = line.substr(line.find(':') + 2);
+            break;
+        }
+    report.set("cpu", cpu);
+    report.set("hardware_threads", std::to_string(std::thread::hardware_concurrency()));
+
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    report.set("timestamp", stamp);
+}
+
+// Regularised incomplete beta I_x(a, b) by Lentz's continued fraction (Numerical Recipes 6.4)
+inline double incomplete_beta(double a, double b, double x)
+{
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+    if (x > (a + 1) / (a + b + 2))
+        return 1 - incomplete_beta(b, a, 1 - x);
+
+    const double tiny = 1e-300;
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1 - x)) / a;
+    double c = 1, d = 1 - (a + b) * x / (a + 1);
+    d = 1 / (std::abs(d) < tiny ? tiny : d);
+    double f = d;
+
+    for (int m = 1; m <= 200; ++m)
+    {
+        for (int step = 0; step < 2; ++step)
+        {
+            double numerator = step == 0 ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                                         : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+            d = 1 + numerator * d;
+            d = 1 / (std::abs(d) < tiny ? tiny : d);
+            c = 1 + numerator / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            f *= c * d;
+        }
+        if (std::abs(c * d - 1) < 1e-12)
+            break;
+    }
+    return front * f;
+}
+
+struct SampleStats
+{
+    std::size_t n = 0;
+    double mean = 0, variance = 0;
+
+    explicit SampleStats(const std::vector<double> &values) : n(values.size())
+    {
+        for (double v : values)
+            mean += v / n;
+        for (double v : values)
+            variance += n > 1 ? (v - mean) * (v - mean) / (n - 1) : 0;
+    }
+};
+
+// Two-sided p-value of Welch's unequal-variance t-test; NaN when either side has fewer than two samples
+inline double welch_p_value(const SampleStats &a, const SampleStats &b)
+{
+    if (a.n < 2 || b.n < 2)
+        return std::nan("");
+
+    double se2 = a.variance / a.n + b.variance / b.n;
+    if (se2 == 0)
+        return a.mean == b.mean ? 1.0 : 0.0;
+
+    double t = (a.mean - b.mean) / std::sqrt(se2);
+    double df = se2 * se2 / (std::pow(a.variance / a.n, 2) / (a.n - 1) + std::pow(b.variance / b.n, 2) / (b.n - 1));
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t));
+}
+
+/**
+ * Compares a baseline and a candidate CSV measurement by measurement (suite, subject, metric, unit, size),
+ * pooling repetitions. A change is flagged when it moves the metric in its worse direction by more than
+ * `threshold` (a fraction) and Welch's test gives p < alpha. With fewer than two repetitions on either side
+ * there is no test, so a change past the threshold is listed as untested and never counted as a regression.
+ * Returns the number of regressions, or -1 if a file cannot be read.
+ */
+inline int compare_reports(const std::string &base_path, const std::string &new_path, double alpha, double threshold)
+{
+    std::vector<Measurement> base_rows, new_rows;
+    if (!BenchmarkReport::read_csv(base_path, base_rows) || !BenchmarkReport::read_csv(new_path, new_rows))
+    {
+        std::cerr << "cannot read " << base_path << " or " << new_path << " as benchmark CSV\n";
+        return -1;
+    }
+
+    using Key = std::tuple<std::string, std::string, std::string, std::string, long long>;
+    std::map<Key, std::pair<std::vector<double>, std::vector<double>>> samples;
+    for (const Measurement &m : base_rows)
+        samples[{m.suite, m.subject, m.metric, m.unit, m.size}].first.push_back(m.value);
+    for (const Measurement &m : new_rows)
+        samples[{m.suite, m.subject, m.metric, m.unit, m.size}].second.push_back(m.value);
+
+    const std::string header = "| Verdict     | Suite / Subject / Metric                                   |     Base |      New |  Change |       p |";
+    std::cout << "\n--- Comparing " << new_path << " against " << base_path << " (alpha " << alpha << ", threshold "
+              << threshold * 100 << "%) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    int regressions = 0, improvements = 0, unchanged = 0, untested = 0, unmatched = 0;
+    for (const auto &[key, values] : samples)
+    {
+        const auto &[suite, subject, metric, unit, size] = key;
+        if (values.first.empty() || values.second.empty())
+        {
+            ++unmatched;
+            continue;
+        }
+
+        SampleStats base(values.first), candidate(values.second);
+        double change = base.mean != 0 ? (candidate.mean - base.mean) / std::abs(base.mean) : 0;
+        double worse = higher_is_better(unit) ? -change : change;
+        double p = welch_p_value(base, candidate);
+        bool significant = !std::isnan(p) && p < alpha;
+
+        const char *verdict = nullptr;
+        if (std::isnan(p) && std::abs(worse) > threshold)
+            verdict = "untested", ++untested;
+        else if (significant && worse > threshold)
+            verdict = "REGRESSION", ++regressions;
+        else if (significant && worse < -threshold)
+            verdict = "improved", ++improvements;
+        else
+        {
+            ++unchanged;
+            continue;
+        }
+
+        std::string label = suite + " / " + subject + " / " + metric + " @" + std::to_string(size);
+        if (label.size() > 58)
+            label = label.substr(0, 55) + "...";
+        std::cout << "| " << std::left << std::setw(12) << verdict << "| " << std::setw(59) << label << std::right << std::fixed
+                  << "| " << std::setw(8) << std::setprecision(2) << base.mean << " | " << std::setw(8) << candidate.mean << " | "
+                  << std::setw(6) << std::setprecision(1) << change * 100 << "% | ";
+        if (std::isnan(p))
+            std::cout << std::setw(7) << "n<2" << " |\n";
+        else
+            std::cout << std::setw(7) << std::setprecision(4) << p << " |\n";
+    }
+
+    std::cout << std::string(header.size(), '-') << "\n";
+    std::cout << regressions << " regressions, " << improvements << " improvements, " << unchanged << " unchanged, " << untested
+              << " untested, " << unmatched << " only in one file\n";
+    if (untested > 0)
+        std::cout << "Untested changes have fewer than 2 repetitions on a side - save both runs with --repeat=2 or more to test them\n";
+    return regressions;
+}
+
+#endif
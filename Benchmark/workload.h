@@ -0,0 +1,242 @@
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// Operation streams for the benchmark - generated up front from a fixed seed so every tree replays
+// exactly the same sequence and generation never shows up in the timings
+enum class OpType : std::uint8_t
+{
+    READ,              // find(key)
+    UPDATE,            // remove(key) then add(key) - the trees hold bare keys, so a write is a re-insert
+    INSERT,            // add(key) of a key not loaded yet
+    REMOVE,            // remove(key)
+    SCAN,              // find(key), find(key + 1), ... length keys - a range read through point lookups
+    READ_MODIFY_WRITE, // find(key), then an update if it was there
+};
+
+struct Operation
+{
+    OpType type;
+    int key;
+    int length;
+};
+
+struct Workload
+{
+    std::string name;
+    std::vector<int> preload; // Inserted (untimed, in this order) before the operations run
+    std::vector<Operation> ops;
+};
+
+// Zipfian ranks over [0, n) after Gray et al., "Quickly Generating Billion-Record Synthetic Databases"
+// (the YCSB generator) - rank 0 is the most popular. n can grow, which extends zeta(n) incrementally
+class ZipfianGenerator
+{
+public:
+    static constexpr double DEFAULT_THETA = 0.99;
+
+    explicit ZipfianGenerator(std::uint64_t n, double theta = DEFAULT_THETA) : items(0), theta(theta), zetan(0)
+    {
+        alpha = 1.0 / (1.0 - theta);
+        zeta2 = 1.0 + std::pow(0.5, theta);
+        grow(n);
+    }
+
+    void grow(std::uint64_t n)
+    {
+        for (; items < n; ++items)
+            zetan += 1.0 / std::pow(static_cast<double>(items + 1), theta);
+        eta = (1.0 - std::pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    std::uint64_t size() const { return items; }
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng &rng)
+    {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0)
+            return 0;
+        if (uz < zeta2)
+            return 1;
+        return std::min<std::uint64_t>(items - 1, static_cast<std::uint64_t>(items * std::pow(eta * u - eta + 1.0, alpha)));
+    }
+
+private:
+    std::uint64_t items;
+    double theta, alpha, zeta2, zetan, eta;
+};
+
+// Zipfian popularity with the hot ranks hashed all over [0, n) - same skew, no spatial locality
+class ScrambledZipfianGenerator
+{
+public:
+    explicit ScrambledZipfianGenerator(std::uint64_t n, double theta = ZipfianGenerator::DEFAULT_THETA) : zipf(n, theta), items(n) {}
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng &rng)
+    {
+        return fnv1a(zipf(rng)) % items;
+    }
+
+private:
+    ZipfianGenerator zipf;
+    std::uint64_t items;
+
+    static std::uint64_t fnv1a(std::uint64_t value)
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (int i = 0; i < 8; ++i, value >>= 8)
+            hash = (hash ^ (value & 0xff)) * 0x100000001b3ull;
+        return hash;
+    }
+};
+
+// Keys 0..records-1 in shuffled order - the usual starting state for the YCSB mixes
+inline std::vector<int> shuffled_keys(int records, std::mt19937_64 &rng)
+{
+    std::vector<int> keys(records);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+// YCSB core workloads A-F (Cooper et al., SoCC 2010) over `records` preloaded keys
+// A 50/50 read/update, B 95/5 read/update, C read only, F 50/50 read/read-modify-write - all Zipfian
+// D 95/5 read/insert with reads skewed towards the newest keys, E 95/5 scan/insert with Zipfian scan starts
+// scrambled picks between hot keys clustered at the low end of the key space and hot keys spread by hash
+inline Workload make_ycsb(char mix, int records, int operations, std::uint64_t seed, bool scrambled = false, int max_scan = 32)
+{
+    std::mt19937_64 rng(seed);
+    Workload workload{std::string("YCSB-") + mix + (scrambled ? " scrambled" : ""), shuffled_keys(records, rng), {}};
+    workload.ops.reserve(operations);
+
+    ZipfianGenerator zipf(records);
+    ScrambledZipfianGenerator scrambled_zipf(records);
+    auto popular = [&]() { return static_cast<int>(scrambled ? scrambled_zipf(rng) : zipf(rng)); };
+
+    std::uniform_int_distribution<int> percent(0, 99), scan_length(1, max_scan);
+    int next_key = records;
+
+    for (int i = 0; i < operations; ++i)
+    {
+        int p = percent(rng);
+        switch (mix)
+        {
+        case 'A':
+            workload.ops.push_back({p < 50 ? OpType::READ : OpType::UPDATE, popular(), 1});
+            break;
+        case 'B':
+            workload.ops.push_back({p < 95 ? OpType::READ : OpType::UPDATE, popular(), 1});
+            break;
+        case 'C':
+            workload.ops.push_back({OpType::READ, popular(), 1});
+            break;
+        case 'D':
+            if (p < 95)
+            {
+                // Latest distribution - Zipfian over the age of the key, newest first
+                zipf.grow(next_key);
+                workload.ops.push_back({OpType::READ, next_key - 1 - static_cast<int>(zipf(rng)), 1});
+            }
+            else
+                workload.ops.push_back({OpType::INSERT, next_key++, 1});
+            break;
+        case 'E':
+            if (p < 95)
+                workload.ops.push_back({OpType::SCAN, popular(), scan_length(rng)});
+            else
+                workload.ops.push_back({OpType::INSERT, next_key++, 1});
+            break;
+        default:
+            workload.ops.push_back({p < 50 ? OpType::READ : OpType::READ_MODIFY_WRITE, popular(), 1});
+            break;
+        }
+    }
+
+    return workload;
+}
+
+// Reads spread uniformly over the loaded keys - the no-locality baseline for the skewed mixes
+inline Workload make_uniform_reads(int records, int operations, std::uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    Workload workload{"Uniform reads", shuffled_keys(records, rng), {}};
+    workload.ops.reserve(operations);
+
+    std::uniform_int_distribution<int> any_key(0, records - 1);
+    for (int i = 0; i < operations; ++i)
+        workload.ops.push_back({OpType::READ, any_key(rng), 1});
+
+    return workload;
+}
+
+// A hot window of `hot_fraction` of the key space takes `hot_percent`% of the traffic and slides forward
+// `shifts` times over the run - popularity that drifts, as in session or time-bucketed traffic
+inline Workload make_hot_set(int records, int operations, std::uint64_t seed, double hot_fraction = 0.01, int hot_percent = 90,
+                             int shifts = 50)
+{
+    std::mt19937_64 rng(seed);
+    Workload workload{"Moving hot-set", shuffled_keys(records, rng), {}};
+    workload.ops.reserve(operations);
+
+    int window = std::max(1, static_cast<int>(records * hot_fraction));
+    int step = std::max(1, operations / std::max(1, shifts));
+    std::uniform_int_distribution<int> percent(0, 99), any_key(0, records - 1), in_window(0, window - 1);
+
+    for (int i = 0; i < operations; ++i)
+    {
+        int base = static_cast<int>((static_cast<long long>(i / step) * window) % records);
+        int key = percent(rng) < hot_percent ? (base + in_window(rng)) % records : any_key(rng);
+        workload.ops.push_back({percent(rng) < 95 ? OpType::READ : OpType::UPDATE, key, 1});
+    }
+
+    return workload;
+}
+
+// Sawtooth size: ascending keys are appended until the tree holds `records`, then the oldest are removed
+// until it is down to half, and again - the queue/time-series pattern of steady inserts and bulk expiry
+inline Workload make_sawtooth(int records, int operations, std::uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    Workload workload{"Sawtooth", {}, {}};
+    workload.ops.reserve(operations);
+
+    // A little jitter on the appended keys so they are not perfectly sorted
+    std::uniform_int_distribution<int> jitter(0, 3);
+    std::vector<int> live;
+    std::size_t oldest = 0;
+    int next_key = 0;
+    bool growing = true;
+
+    for (int i = 0; i < operations; ++i)
+    {
+        std::size_t size = live.size() - oldest;
+        if (growing && size >= static_cast<std::size_t>(records))
+            growing = false;
+        else if (!growing && size <= static_cast<std::size_t>(records / 2))
+            growing = true;
+
+        if (growing)
+        {
+            next_key += 1 + jitter(rng);
+            live.push_back(next_key);
+            workload.ops.push_back({OpType::INSERT, next_key, 1});
+        }
+        else
+            workload.ops.push_back({OpType::REMOVE, live[oldest++], 1});
+    }
+
+    return workload;
+}
+
+#endif
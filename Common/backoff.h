@@ -0,0 +1,34 @@
+#ifndef __BACKOFF_H__
+#define __BACKOFF_H__
+
+#include <thread>
+
+// Spin hint for busy-wait loops - lets the sibling hyperthread run and saves power
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Retry pacing for optimistic operations - spins for a few attempts, then yields so a preempted latch
+// holder can get the core back (which matters as soon as there are more threads than cores)
+class Backoff
+{
+public:
+    void operator()()
+    {
+        if (++attempt < SPIN_ATTEMPTS)
+            cpu_relax();
+        else
+            std::this_thread::yield();
+    }
+
+private:
+    static constexpr int SPIN_ATTEMPTS = 16;
+    int attempt = 0;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __COMPARE_H__
+#define __COMPARE_H__
+
+#include <compare>
+#include <concepts>
+#include <functional>
+#include <type_traits>
+
+// Comparators that answer with an ordering (std::compare_three_way, ...) rather than a bool
+template <typename Compare, typename T>
+concept three_way_comparator = requires(const Compare &cmp, const T &a) {
+    { cmp(a, a) } -> std::convertible_to<std::weak_ordering>;
+};
+
+// One comparison that tells less, equal and greater apart
+// - three-way comparators are called as is
+// - std::less over a type with a total operator<=> uses operator<=> (one pass over a string, say)
+// - any other less-than comparator needs a second call, and only when the first says "not less"
+template <typename Compare, typename T>
+inline std::weak_ordering three_way(const Compare &cmp, const T &a, const T &b)
+{
+    if constexpr (three_way_comparator<Compare, T>)
+        return cmp(a, b);
+    else if constexpr ((std::is_same_v<Compare, std::less<T>> || std::is_same_v<Compare, std::less<>>) && std::three_way_comparable<T, std::weak_ordering>)
+        return a <=> b;
+    else if (cmp(a, b))
+        return std::weak_ordering::less;
+    else
+        return cmp(b, a) ? std::weak_ordering::greater : std::weak_ordering::equivalent;
+}
+
+// Plain a < b through either kind of comparator
+template <typename Compare, typename T>
+inline bool is_less(const Compare &cmp, const T &a, const T &b)
+{
+    if constexpr (three_way_comparator<Compare, T>)
+        return cmp(a, b) < 0;
+    else
+        return cmp(a, b);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __COUNTING_ALLOCATOR_H__
+#define __COUNTING_ALLOCATOR_H__
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <algorithm>
+
+// Running totals of what passed through a CountingAllocator
+struct AllocationCounter
+{
+    std::size_t live_bytes = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+
+    void reset() { *this = AllocationCounter(); }
+};
+
+// Process-wide counter used by default-constructed CountingAllocators - the trees default-construct
+// their allocator, so this is how a benchmark reads what a tree allocated (not thread-safe)
+inline AllocationCounter &default_allocation_counter()
+{
+    static AllocationCounter counter;
+    return counter;
+}
+
+// Allocator hook that forwards to Base and tallies requested bytes in an AllocationCounter
+// Plug it in as a tree's Alloc argument, e.g. AVLTree<int, std::less<int>, CountingAllocator<int>>,
+// or wrap another allocator: CountingAllocator<int, NodePool<int>> counts node requests served by the pool
+template <typename T, typename Base = std::allocator<T>>
+class CountingAllocator
+{
+    using BaseTraits = std::allocator_traits<Base>;
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = typename BaseTraits::propagate_on_container_copy_assignment;
+    using propagate_on_container_move_assignment = typename BaseTraits::propagate_on_container_move_assignment;
+    using propagate_on_container_swap = typename BaseTraits::propagate_on_container_swap;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = CountingAllocator<U, typename BaseTraits::template rebind_alloc<U>>;
+    };
+
+    // Constructors
+    CountingAllocator() : counter(&default_allocation_counter()) {}
+    explicit CountingAllocator(AllocationCounter &counter, const Base &base = Base()) : base(base), counter(&counter) {}
+
+    template <typename U, typename OtherBase>
+    CountingAllocator(const CountingAllocator<U, OtherBase> &other) : base(other.base), counter(other.counter) {}
+
+    CountingAllocator select_on_container_copy_construction() const
+    {
+        return CountingAllocator(*counter, BaseTraits::select_on_container_copy_construction(base));
+    }
+
+    T *allocate(std::size_t n)
+    {
+        T *p = BaseTraits::allocate(base, n);
+        counter->live_bytes += n * sizeof(T);
+        counter->peak_bytes = std::max(counter->peak_bytes, counter->live_bytes);
+        counter->allocations++;
+        return p;
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        BaseTraits::deallocate(base, p, n);
+        counter->live_bytes -= n * sizeof(T);
+        counter->deallocations++;
+    }
+
+    const AllocationCounter &stats() const { return *counter; }
+
+    template <typename U, typename OtherBase>
+    bool operator==(const CountingAllocator<U, OtherBase> &other) const
+    {
+        return counter == other.counter && base == other.base;
+    }
+
+private:
+    template <typename, typename>
+    friend class CountingAllocator;
+
+    Base base;
+    AllocationCounter *counter;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+// Epoch-based reclamation (Fraser, "Practical lock-freedom") - lets readers walk nodes that a writer
+// may unlink at any moment, without reference counts or locks on the read path
+// A reader pins the current global epoch in its own cache-line-sized slot for the length of an operation.
+// The global epoch only advances once every pinned reader has seen it, so anything unlinked while the
+// epoch was e can no longer be reached by any reader once the epoch reaches e + 2
+class EpochDomain
+{
+public:
+    static constexpr std::uint64_t IDLE = ~std::uint64_t(0);
+    static constexpr std::size_t MAX_THREADS = 256;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<std::uint64_t> epoch{IDLE};
+        std::atomic<bool> claimed{false};
+        int depth = 0; // Only touched by the owning thread
+    };
+
+public:
+    // Process-wide domain - every epoch-protected structure shares the reader slots, so a thread pins once
+    // however many structures it reads
+    static EpochDomain &global()
+    {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    // Pins the calling thread for its lifetime - nests, only the outermost guard pins and unpins
+    class Guard
+    {
+    public:
+        Guard() : slot(global().local_slot())
+        {
+            if (slot.depth++ == 0)
+            {
+                // Every epoch access is seq_cst, as are the structure's pointer loads and unlink stores, so they
+                // all fall in one total order - the pin is visible before any shared pointer is read, and the
+                // epoch a writer tags its retired nodes with is no older than one a reader could have pinned.
+                // Structures sharing the domain have separate writer locks, so nothing weaker orders their
+                // advances against each other's retires
+                slot.epoch.store(global().epoch.load());
+            }
+        }
+
+        ~Guard()
+        {
+            if (--slot.depth == 0)
+                slot.epoch.store(IDLE, std::memory_order_release);
+        }
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        Slot &slot;
+    };
+
+    std::uint64_t current() const
+    {
+        return epoch.load();
+    }
+
+    // Moves the epoch on if every pinned thread has seen the current one - returns the epoch afterwards
+    std::uint64_t try_advance()
+    {
+        std::uint64_t now = epoch.load();
+        std::size_t count = slots_used.load(std::memory_order_acquire);
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            std::uint64_t pinned = slots[i].epoch.load();
+            if (pinned != IDLE && pinned != now)
+                return now;
+        }
+
+        epoch.compare_exchange_strong(now, now + 1);
+        return epoch.load();
+    }
+
+private:
+    // A thread's slot, claimed on first use and handed back when the thread exits
+    struct SlotHandle
+    {
+        Slot *slot = nullptr;
+
+        ~SlotHandle()
+        {
+            if (slot)
+                slot->claimed.store(false, std::memory_order_release);
+        }
+    };
+
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<std::size_t> slots_used{0};
+    Slot slots[MAX_THREADS];
+
+    EpochDomain() = default;
+
+    Slot &local_slot()
+    {
+        thread_local SlotHandle handle;
+        if (handle.slot)
+            return *handle.slot;
+
+        for (std::size_t i = 0; i < MAX_THREADS; i++)
+        {
+            bool expected = false;
+            if (!slots[i].claimed.load(std::memory_order_relaxed) && slots[i].claimed.compare_exchange_strong(expected, true))
+            {
+                // Publish the slot to try_advance before it can hold a pin
+                for (std::size_t used = slots_used.load(); used <= i && !slots_used.compare_exchange_weak(used, i + 1);)
+                    ;
+                handle.slot = &slots[i];
+                return slots[i];
+            }
+        }
+
+        throw std::runtime_error("EpochDomain: more than MAX_THREADS threads pinned at once");
+    }
+};
+
+// Nodes a writer has unlinked, each tagged with the epoch it was unlinked in and freed two epochs later
+// Not synchronised - it belongs to whoever serialises the writers of one structure
+template <typename T>
+class RetireList
+{
+public:
+    void retire(T *node)
+    {
+        pending.emplace_back(domain.current(), node);
+    }
+
+    // Frees what no reader can reach any more, and nudges the epoch forward so the rest follows
+    template <typename Free>
+    void reclaim(Free free)
+    {
+        std::uint64_t now = domain.try_advance();
+        std::size_t kept = 0;
+        for (auto &[retired_at, node] : pending)
+        {
+            if (retired_at + 2 <= now)
+                free(node);
+            else
+                pending[kept++] = {retired_at, node};
+        }
+        pending.resize(kept);
+    }
+
+    // Frees everything - only once no reader can be inside the structure
+    template <typename Free>
+    void clear(Free free)
+    {
+        for (auto &[retired_at, node] : pending)
+            free(node);
+        pending.clear();
+    }
+
+    std::size_t size() const { return pending.size(); }
+
+private:
+    EpochDomain &domain = EpochDomain::global();
+    std::vector<std::pair<std::uint64_t, T *>> pending;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __INSTRUMENTATION_H__
+#define __INSTRUMENTATION_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Instrumentation policies - the trees take one as their last template argument and report events to it
+// NoStats is the default: every hook is an empty inline function and the member takes no space
+// ([[no_unique_address]]), so an uninstrumented tree compiles to exactly the code it had before
+struct NoStats
+{
+    static constexpr bool enabled = false;
+
+    void comparison() {}
+    void visit() {}
+    void rotation() {}
+    void split() {}
+    void merge() {}
+    void borrow() {}
+    void splay(std::size_t) {}
+    void reset() {}
+};
+
+// Counts every event - for explaining throughput differences and tuning the B-Tree order without a profiler
+struct TreeStats
+{
+    static constexpr bool enabled = true;
+
+    std::uint64_t comparisons = 0; // Comparator calls (the B-Tree's vectorised rank makes none)
+    std::uint64_t visits = 0;      // Nodes examined on the way down
+    std::uint64_t rotations = 0;   // Single rotations - a double rotation counts two
+    std::uint64_t splits = 0;      // B-Tree node splits
+    std::uint64_t merges = 0;      // B-Tree node merges
+    std::uint64_t borrows = 0;     // B-Tree key rotations through the parent (left_shift / right_shift)
+    std::uint64_t splays = 0;      // Splay operations
+    std::uint64_t splay_depth = 0; // Total depth of the splayed nodes
+    std::uint64_t max_splay_depth = 0;
+
+    void comparison() { comparisons++; }
+    void visit() { visits++; }
+    void rotation() { rotations++; }
+    void split() { splits++; }
+    void merge() { merges++; }
+    void borrow() { borrows++; }
+
+    void splay(std::size_t depth)
+    {
+        splays++;
+        splay_depth += depth;
+        max_splay_depth = std::max<std::uint64_t>(max_splay_depth, depth);
+    }
+
+    void reset() { *this = TreeStats(); }
+};
+
+#endif
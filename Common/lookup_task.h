@@ -0,0 +1,183 @@
+#ifndef __LOOKUP_TASK_H__
+#define __LOOKUP_TASK_H__
+
+#include <coroutine>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+
+#include "prefetch.h"
+
+// A lookup written as a coroutine - it suspends every time it prefetches the next node, and a scheduler
+// (run_interleaved) resumes other lookups while the line is on its way. The same latency hiding as the
+// lockstep find_batch, but each descent keeps the shape of a plain find and finishes on its own schedule
+class LookupTask
+{
+public:
+    struct promise_type
+    {
+        bool result = false;
+
+        LookupTask get_return_object() { return LookupTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(bool found) { result = found; }
+        void unhandled_exception() { throw; }
+
+        // A task is created per key, so frames are recycled rather than taken from malloc every time
+        static void *operator new(std::size_t size) { return frames().take(size); }
+        static void operator delete(void *frame, std::size_t size) { frames().give(frame, size); }
+    };
+
+    // Constructors
+    LookupTask() : handle(nullptr) {}
+    explicit LookupTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    // Destructor
+    ~LookupTask()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    // Copy
+    LookupTask(const LookupTask &) = delete;
+    LookupTask &operator=(const LookupTask &) = delete;
+
+    // Move
+    LookupTask(LookupTask &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    LookupTask &operator=(LookupTask &&other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        if (handle)
+            handle.destroy();
+        handle = std::exchange(other.handle, nullptr);
+        return *this;
+    }
+
+    explicit operator bool() const { return handle != nullptr; }
+    bool done() const { return handle.done(); }
+    void resume() { handle.resume(); }
+    bool result() const { return handle.promise().result; }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    // Per-thread stack of freed frames of one size - a run only ever creates frames of the same coroutine
+    class FrameCache
+    {
+    public:
+        ~FrameCache()
+        {
+            while (head)
+                ::operator delete(std::exchange(head, head->next));
+        }
+
+        void *take(std::size_t size)
+        {
+            if (head == nullptr || size != block_size)
+                return ::operator new(size);
+            count--;
+            return std::exchange(head, head->next);
+        }
+
+        void give(void *frame, std::size_t size)
+        {
+            if (count == MAX_CACHED || (head && size != block_size) || size < sizeof(Block))
+            {
+                ::operator delete(frame);
+                return;
+            }
+
+            block_size = size;
+            head = new (frame) Block{head};
+            count++;
+        }
+
+    private:
+        struct Block
+        {
+            Block *next;
+        };
+
+        static constexpr std::size_t MAX_CACHED = 64;
+        Block *head = nullptr;
+        std::size_t block_size = 0, count = 0;
+    };
+
+    static FrameCache &frames()
+    {
+        thread_local FrameCache cache;
+        return cache;
+    }
+};
+
+// co_await prefetched(node) - hints the node's lines and hands control back to the scheduler
+struct prefetched
+{
+    const void *address;
+    std::size_t bytes = 1;
+
+    bool await_ready() const noexcept
+    {
+        prefetch_range(address, bytes);
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    void await_resume() const noexcept {}
+};
+
+// Round-robin scheduler - keeps up to in_flight lookups going, resuming each in turn and starting the next
+// key in a slot as soon as its lookup finishes. out[i] receives the result of make_task(keys[i])
+inline constexpr std::size_t MAX_LOOKUPS_IN_FLIGHT = 64;
+
+template <typename T, typename MakeTask>
+void run_interleaved(std::span<const T> keys, std::span<bool> out, std::size_t in_flight, MakeTask make_task)
+{
+    assert(out.size() >= keys.size());
+    in_flight = std::clamp<std::size_t>(in_flight, 1, MAX_LOOKUPS_IN_FLIGHT);
+
+    LookupTask tasks[MAX_LOOKUPS_IN_FLIGHT];
+    std::size_t index[MAX_LOOKUPS_IN_FLIGHT];
+    std::size_t slots = std::min(in_flight, keys.size()), next = 0, running = slots;
+
+    for (; next < slots; next++)
+    {
+        tasks[next] = make_task(keys[next]);
+        index[next] = next;
+    }
+
+    while (running)
+    {
+        for (std::size_t s = 0; s < slots; s++)
+        {
+            LookupTask &task = tasks[s];
+            if (!task)
+                continue;
+
+            task.resume();
+            if (!task.done())
+                continue;
+
+            out[index[s]] = task.result();
+            if (next < keys.size())
+            {
+                task = make_task(keys[next]);
+                index[s] = next++;
+            }
+            else
+            {
+                task = LookupTask();
+                running--;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __MEMORY_USAGE_H__
+#define __MEMORY_USAGE_H__
+
+#include <cstddef>
+#include <algorithm>
+#include <concepts>
+
+// Footprint of a tree as reported by its memory_usage() - counted by walking the nodes, so it is exact for
+// the nodes themselves and leaves allocator bookkeeping (malloc headers, pool slack) to `reserved`
+struct MemoryUsage
+{
+    std::size_t keys = 0;
+    std::size_t nodes = 0;
+    std::size_t leaves = 0;    // Nodes without children
+    std::size_t internals = 0; // Nodes with at least one child
+    std::size_t bytes = 0;     // Bytes of the live nodes
+    std::size_t reserved = 0;  // Bytes the node allocator holds from the system, when it can tell (NodePool); else 0
+    double fill = 0;           // Keys stored / key slots in the live nodes
+
+    // Counts what the tree actually holds on to - the pool's slabs if known, otherwise the nodes
+    double bytes_per_key() const
+    {
+        return keys ? static_cast<double>(std::max(bytes, reserved)) / keys : 0;
+    }
+};
+
+// Allocators that can report how many bytes they have taken from the system
+template <typename Alloc>
+concept reserving_allocator = requires(const Alloc &alloc) { { alloc.reserved() } -> std::convertible_to<std::size_t>; };
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __NODE_LAYOUT_H__
+#define __NODE_LAYOUT_H__
+
+#include <cstdint>
+#include <cstddef>
+
+// Node layout policies - RBTree and AVLTree take one as their last template argument
+// PlainLayout keeps the balancing metadata (colour, height) in a field of its own. PackedLayout hides it in
+// the low bits of a node pointer, which are always zero since nodes are pointer aligned: the node loses a
+// field and its padding, so more of the tree fits in each cache line and in the last-level cache
+struct PlainLayout
+{
+    static constexpr bool PACKED = false;
+};
+
+struct PackedLayout
+{
+    static constexpr bool PACKED = true;
+};
+
+// A node pointer with a Bits-wide tag in its alignment bits - Node may still be incomplete where it is declared
+template <typename Node, unsigned Bits>
+class TaggedPtr
+{
+public:
+    static constexpr std::uintptr_t MASK = (std::uintptr_t(1) << Bits) - 1;
+
+    TaggedPtr() = default;
+    TaggedPtr(Node *ptr, unsigned tag = 0) : bits(reinterpret_cast<std::uintptr_t>(ptr) | tag) {}
+
+    Node *ptr() const
+    {
+        static_assert(alignof(Node) > MASK, "node alignment leaves no room for the tag");
+        return reinterpret_cast<Node *>(bits & ~MASK);
+    }
+
+    unsigned tag() const { return bits & MASK; }
+
+    void set_ptr(Node *ptr) { bits = reinterpret_cast<std::uintptr_t>(ptr) | (bits & MASK); }
+    void set_tag(unsigned tag) { bits = (bits & ~MASK) | tag; }
+
+private:
+    std::uintptr_t bits = 0;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef __NODE_POOL_H__
+#define __NODE_POOL_H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+
+// Slab allocator for fixed-size tree nodes - one size class per instantiation
+// Nodes are bump-allocated out of 64 KiB slabs and recycled through an intrusive free list,
+// so inserts and removes never reach malloc once the pool is warm and neighbouring nodes share cache lines
+// A pool belongs to one tree: copies start out empty, moves take the slabs along, and release()
+// drops every node at once
+template <typename T>
+class NodePool
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = NodePool<U>;
+    };
+
+    // Constructors
+    NodePool() noexcept : free_list(nullptr), slabs(nullptr), bump(nullptr), bump_end(nullptr) {}
+
+    template <typename U>
+    NodePool(const NodePool<U> &) noexcept : NodePool() {}
+
+    // Copy - nodes are never shared between pools
+    NodePool(const NodePool &) noexcept : NodePool() {}
+    NodePool &operator=(const NodePool &) = delete;
+
+    NodePool select_on_container_copy_construction() const
+    {
+        return NodePool();
+    }
+
+    // Move
+    NodePool(NodePool &&other) noexcept : free_list(other.free_list), slabs(other.slabs), bump(other.bump), bump_end(other.bump_end)
+    {
+        other.free_list = nullptr;
+        other.slabs = nullptr;
+        other.bump = other.bump_end = nullptr;
+    }
+
+    NodePool &operator=(NodePool &&other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        release();
+        std::swap(free_list, other.free_list);
+        std::swap(slabs, other.slabs);
+        std::swap(bump, other.bump);
+        std::swap(bump_end, other.bump_end);
+        return *this;
+    }
+
+    // Destructor
+    ~NodePool()
+    {
+        release();
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (n != 1)
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+
+        if (free_list)
+        {
+            Slot *slot = free_list;
+            free_list = slot->next;
+            return reinterpret_cast<T *>(slot);
+        }
+
+        if (bump == bump_end)
+            grow();
+        return reinterpret_cast<T *>(bump++);
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        if (n != 1)
+        {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+            return;
+        }
+
+        Slot *slot = reinterpret_cast<Slot *>(p);
+        slot->next = free_list;
+        free_list = slot;
+    }
+
+    // Frees every slab - outstanding nodes are dropped without running destructors
+    void release() noexcept
+    {
+        while (slabs)
+        {
+            Slab *next = slabs->next;
+            ::operator delete(slabs, std::align_val_t(alignof(Slab)));
+            slabs = next;
+        }
+
+        free_list = nullptr;
+        bump = bump_end = nullptr;
+    }
+
+    // Bytes held in slabs, used or not
+    std::size_t reserved() const noexcept
+    {
+        std::size_t count = 0;
+        for (Slab *slab = slabs; slab; slab = slab->next)
+            count++;
+        return count * sizeof(Slab);
+    }
+
+    bool operator==(const NodePool &other) const noexcept
+    {
+        return this == &other;
+    }
+
+private:
+    union Slot
+    {
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr std::size_t SLAB_BYTES = 64 * 1024;
+    static constexpr std::size_t SLOTS_PER_SLAB = std::max<std::size_t>(SLAB_BYTES / sizeof(Slot), 16);
+
+    struct Slab
+    {
+        Slab *next;
+        Slot slots[SLOTS_PER_SLAB];
+    };
+
+    Slot *free_list;
+    Slab *slabs;
+    Slot *bump, *bump_end;
+
+    void grow()
+    {
+        Slab *slab = static_cast<Slab *>(::operator new(sizeof(Slab), std::align_val_t(alignof(Slab))));
+        slab->next = slabs;
+        slabs = slab;
+        bump = slab->slots;
+        bump_end = slab->slots + SLOTS_PER_SLAB;
+    }
+};
+
+// Allocators whose nodes can all be dropped at once - trees use this to clear without a traversal
+template <typename Alloc>
+concept releasable_allocator = requires(Alloc &alloc) { alloc.release(); };
+
+#endif
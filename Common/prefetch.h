@@ -0,0 +1,84 @@
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <algorithm>
+#include <cassert>
+
+// Lookups a find_batch walks in lockstep - enough misses in flight to cover DRAM latency,
+// few enough that every cursor stays in L1
+inline constexpr std::size_t FIND_BATCH_GROUP = 16;
+
+inline constexpr std::size_t CACHE_LINE_BYTES = 64;
+
+// Read hint for the cache line holding p - a no-op where the compiler has no prefetch builtin
+inline void prefetch(const void *p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#endif
+}
+
+// Read hint for every cache line overlapping [p, p + bytes)
+inline void prefetch_range(const void *p, std::size_t bytes)
+{
+    std::uintptr_t line = reinterpret_cast<std::uintptr_t>(p) & ~(CACHE_LINE_BYTES - 1);
+    std::uintptr_t end = reinterpret_cast<std::uintptr_t>(p) + bytes;
+    for (; line < end; line += CACHE_LINE_BYTES)
+        prefetch(reinterpret_cast<const void *>(line));
+}
+
+// The loop behind the trees' find_batch - out[i] is whether the descent for keys[i] from root finds it.
+// Walks FIND_BATCH_GROUP descents in lockstep and prefetches each one's next node, so the cache misses of
+// independent lookups overlap instead of queueing. step(key, node, found) takes a descent one level down:
+// it sets found if node holds the key, and otherwise returns the next node, or nullptr at the bottom
+template <typename T, typename Node, typename Step>
+void run_lockstep(std::span<const T> keys, std::span<bool> out, Node *root, Step step)
+{
+    assert(out.size() >= keys.size());
+    Node *cursor[FIND_BATCH_GROUP];
+
+    for (std::size_t base = 0; base < keys.size(); base += FIND_BATCH_GROUP)
+    {
+        std::size_t n = std::min(FIND_BATCH_GROUP, keys.size() - base);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            cursor[i] = root;
+            out[base + i] = false;
+        }
+
+        for (bool active = root != nullptr; active;)
+        {
+            active = false;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                if (cursor[i] == nullptr)
+                    continue;
+
+                bool found = false;
+                Node *next = step(keys[base + i], cursor[i], found);
+                if (found)
+                {
+                    out[base + i] = true;
+                    cursor[i] = nullptr;
+                    continue;
+                }
+
+                cursor[i] = next;
+                if (next)
+                {
+                    // A node wider than a line is prefetched whole - a B-Tree search reads all its keys
+                    if constexpr (sizeof(Node) > CACHE_LINE_BYTES)
+                        prefetch_range(next, sizeof(Node));
+                    else
+                        prefetch(next);
+                    active = true;
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef __CONCURRENT_RBTREE_H__
+#define __CONCURRENT_RBTREE_H__
+
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <stack>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "rbtree.h"
+#include "../Common/compare.h"
+#include "../Common/epoch.h"
+
+// Read-optimised thread-safe red-black tree, RCU style: readers never write to anything another thread reads
+// A published node is never changed. A writer copies every node it has to modify - the path from the root
+// down, plus whatever siblings the rebalancing recolours or rotates - links the copies into a new version
+// of the tree and publishes it with a single store to the root. A reader loads the root once and walks a
+// version that stays consistent however many writers publish after it
+// The replaced nodes go on an epoch retire list and are freed once no reader can still be walking them;
+// the only store a reader makes is pinning the epoch in its own cache line
+// Writers serialise on a mutex - the tree is for read-mostly work, where reads scale with cores and an
+// update costs O(log n) node copies
+// Balancing follows the left-leaning variant (Sedgewick, "Left-leaning Red-Black Trees"): every step is a
+// function from a subtree to its replacement, which is what path copying needs - there are no parent
+// pointers, since a copied node would otherwise have to be re-linked from each of its children
+template <typename T, typename Compare = std::less<T>>
+class ConcurrentRBTree
+{
+public:
+    // Constructor
+    ConcurrentRBTree() : root(nullptr) {}
+
+    // Destructor - no reader may still be inside the tree
+    ~ConcurrentRBTree()
+    {
+        retired.clear([](TreeNode *node) { delete node; });
+
+        std::stack<TreeNode *> st;
+        if (TreeNode *top = root.load(std::memory_order_relaxed))
+            st.push(top);
+
+        while (!st.empty())
+        {
+            TreeNode *top = st.top();
+            st.pop();
+            for (TreeNode *child : top->children)
+                if (child)
+                    st.push(child);
+            delete top;
+        }
+    }
+
+    // Nodes are shared with concurrent readers, so the tree stays where it was built
+    ConcurrentRBTree(const ConcurrentRBTree &) = delete;
+    ConcurrentRBTree &operator=(const ConcurrentRBTree &) = delete;
+
+    // Search - wait-free
+    bool find(const T &val) const
+    {
+        EpochDomain::Guard guard;
+        for (const TreeNode *search = root.load(); search;)
+        {
+            std::weak_ordering cmp = three_way(less_than, val, search->val);
+            if (cmp == 0)
+                return true;
+            search = cmp < 0 ? search->children[LEFT] : search->children[RIGHT];
+        }
+        return false;
+    }
+
+    // Insert
+    bool add(const T &val)
+    {
+        std::lock_guard lock(writer);
+        TreeNode *top = root.load(std::memory_order_relaxed);
+        if (contains(top, val))
+            return false;
+
+        begin();
+        top = insert(top, val);
+        top = mut(top);
+        top->color = BLACK;
+        publish(top);
+        return true;
+    }
+
+    // Delete
+    bool remove(const T &val)
+    {
+        std::lock_guard lock(writer);
+        TreeNode *top = root.load(std::memory_order_relaxed);
+        if (!contains(top, val))
+            return false;
+
+        begin();
+        if (!is_red(top->children[LEFT]) && !is_red(top->children[RIGHT]))
+        {
+            top = mut(top);
+            top->color = RED;
+        }
+
+        top = erase(top, val);
+        if (top)
+        {
+            top = mut(top);
+            top->color = BLACK;
+        }
+        publish(top);
+        return true;
+    }
+
+private: // Node layout
+    struct TreeNode
+    {
+        T val;
+        TreeNode *children[2] = {nullptr, nullptr};
+        color_t color = RED;
+        std::uint64_t version = 0; // The write that created the node - it may only be changed during that write
+    };
+
+private: // Attributes
+    std::atomic<TreeNode *> root;
+    Compare less_than;
+
+    // Writer state, guarded by writer
+    std::mutex writer;
+    std::uint64_t version = 0;
+    std::vector<TreeNode *> replaced;
+    RetireList<TreeNode> retired;
+
+private: // Methods
+    static bool is_red(const TreeNode *node)
+    {
+        return node && node->color == RED;
+    }
+
+    bool contains(const TreeNode *node, const T &val) const
+    {
+        while (node)
+        {
+            std::weak_ordering cmp = three_way(less_than, val, node->val);
+            if (cmp == 0)
+                return true;
+            node = cmp < 0 ? node->children[LEFT] : node->children[RIGHT];
+        }
+        return false;
+    }
+
+    void begin()
+    {
+        version++;
+        replaced.clear();
+    }
+
+    // Swaps in the new version and retires the nodes it replaced - they are unreachable from the new
+    // root, but a reader that loaded the old one may still be on them
+    void publish(TreeNode *top)
+    {
+        // seq_cst, so the epoch the nodes are tagged with is read after the unlink is visible to readers
+        root.store(top);
+        for (TreeNode *old : replaced)
+            retired.retire(old);
+        retired.reclaim([](TreeNode *node) { delete node; });
+    }
+
+    // The node to write to in place of node - node itself if this write created it, otherwise a private
+    // copy. The caller links the result into its own (already private) parent
+    TreeNode *mut(TreeNode *node)
+    {
+        if (node->version == version)
+            return node;
+
+        TreeNode *copy = new TreeNode(*node);
+        copy->version = version;
+        replaced.push_back(node);
+        return copy;
+    }
+
+    // Unlinks a node from the new version
+    void drop(TreeNode *node)
+    {
+        if (node->version == version)
+            delete node; // Never published
+        else
+            replaced.push_back(node);
+    }
+
+    // The rebalancing steps - node is private to this write, and so is what they return
+
+    TreeNode *rotate_left(TreeNode *node)
+    {
+        TreeNode *x = mut(node->children[RIGHT]);
+        node->children[RIGHT] = x->children[LEFT];
+        x->children[LEFT] = node;
+        x->color = node->color;
+        node->color = RED;
+        return x;
+    }
+
+    TreeNode *rotate_right(TreeNode *node)
+    {
+        TreeNode *x = mut(node->children[LEFT]);
+        node->children[LEFT] = x->children[RIGHT];
+        x->children[RIGHT] = node;
+        x->color = node->color;
+        node->color = RED;
+        return x;
+    }
+
+    void flip_colors(TreeNode *node)
+    {
+        node->color = node->color == RED ? BLACK : RED;
+        for (TreeNode *&child : node->children)
+        {
+            child = mut(child);
+            child->color = child->color == RED ? BLACK : RED;
+        }
+    }
+
+    // Restores the left-leaning invariants on the way back up
+    TreeNode *balance(TreeNode *node)
+    {
+        if (is_red(node->children[RIGHT]) && !is_red(node->children[LEFT]))
+            node = rotate_left(node);
+        if (is_red(node->children[LEFT]) && is_red(node->children[LEFT]->children[LEFT]))
+            node = rotate_right(node);
+        if (is_red(node->children[LEFT]) && is_red(node->children[RIGHT]))
+            flip_colors(node);
+        return node;
+    }
+
+    // Makes node's left child or one of its children red, so a delete can go left
+    TreeNode *move_red_left(TreeNode *node)
+    {
+        flip_colors(node);
+        if (is_red(node->children[RIGHT]->children[LEFT]))
+        {
+            node->children[RIGHT] = rotate_right(node->children[RIGHT]);
+            node = rotate_left(node);
+            flip_colors(node);
+        }
+        return node;
+    }
+
+    TreeNode *move_red_right(TreeNode *node)
+    {
+        flip_colors(node);
+        if (is_red(node->children[LEFT]->children[LEFT]))
+        {
+            node = rotate_right(node);
+            flip_colors(node);
+        }
+        return node;
+    }
+
+    // Insert into the subtree - val is known not to be in the tree
+    TreeNode *insert(TreeNode *node, const T &val)
+    {
+        if (node == nullptr)
+        {
+            TreeNode *leaf = new TreeNode{val};
+            leaf->version = version;
+            return leaf;
+        }
+
+        node = mut(node);
+        dir_t dir = is_less(less_than, val, node->val) ? LEFT : RIGHT;
+        node->children[dir] = insert(node->children[dir], val);
+        return balance(node);
+    }
+
+    TreeNode *erase_min(TreeNode *node)
+    {
+        if (node->children[LEFT] == nullptr)
+        {
+            drop(node);
+            return nullptr;
+        }
+
+        node = mut(node);
+        if (!is_red(node->children[LEFT]) && !is_red(node->children[LEFT]->children[LEFT]))
+            node = move_red_left(node);
+        node->children[LEFT] = erase_min(node->children[LEFT]);
+        return balance(node);
+    }
+
+    // Delete from the subtree - val is known to be in it
+    TreeNode *erase(TreeNode *node, const T &val)
+    {
+        node = mut(node);
+        if (is_less(less_than, val, node->val))
+        {
+            if (!is_red(node->children[LEFT]) && !is_red(node->children[LEFT]->children[LEFT]))
+                node = move_red_left(node);
+            node->children[LEFT] = erase(node->children[LEFT], val);
+            return balance(node);
+        }
+
+        if (is_red(node->children[LEFT]))
+            node = rotate_right(node);
+        if (node->children[RIGHT] == nullptr && three_way(less_than, val, node->val) == 0)
+        {
+            drop(node);
+            return nullptr;
+        }
+
+        if (!is_red(node->children[RIGHT]) && !is_red(node->children[RIGHT]->children[LEFT]))
+            node = move_red_right(node);
+
+        if (three_way(less_than, val, node->val) == 0)
+        {
+            // Take the successor's value and delete the successor instead
+            const TreeNode *successor = node->children[RIGHT];
+            while (successor->children[LEFT])
+                successor = successor->children[LEFT];
+            node->val = successor->val;
+            node->children[RIGHT] = erase_min(node->children[RIGHT]);
+        }
+        else
+            node->children[RIGHT] = erase(node->children[RIGHT], val);
+
+        return balance(node);
+    }
+
+private:
+    friend class ConcurrentRBTreeTester;
+};
+
+#endif
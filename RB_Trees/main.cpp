@@ -5,7 +5,13 @@
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <string>
+#include <span>
+#include <memory>
+#include <thread>
+#include <atomic>
 #include "rbtree.h"
+#include "concurrent_rbtree.h"
 
 using namespace std;
 
@@ -33,6 +39,31 @@ public:
         cout << "✅ Basic insert/find passed.\n";
     }
 
+    void test_try_add()
+    {
+        tree.clear();
+        for (int v : {10, 5, 15, 3, 7, 12, 20, 1})
+        {
+            auto [stored, added] = tree.try_add(v);
+            assert(added && stored && *stored == v);
+            test_red_black_properties();
+        }
+
+        // Duplicates report the node already holding the value, and rotations do not move values
+        for (int v : {10, 5, 15, 3, 7, 12, 20, 1})
+        {
+            auto [stored, added] = tree.try_add(v);
+            assert(!added && stored && *stored == v);
+            assert(stored == tree.try_add(v).first);
+        }
+        const int *seven = tree.try_add(7).first;
+        for (int v = 100; v < 200; ++v)
+            tree.add(v);
+        assert(*seven == 7 && seven == tree.try_add(7).first);
+        test_red_black_properties();
+        cout << "✅ try_add passed.\n";
+    }
+
     void test_deletion_cases()
     {
         tree.clear();
@@ -121,21 +152,196 @@ public:
                 return 1;
 
             // Red property: no two red nodes in a row
-            if (n->color == RED)
+            if (n->color() == RED)
             {
-                assert(!n->children[LEFT] || n->children[LEFT]->color == BLACK);
-                assert(!n->children[RIGHT] || n->children[RIGHT]->color == BLACK);
+                assert(!n->children[LEFT] || n->children[LEFT]->color() == BLACK);
+                assert(!n->children[RIGHT] || n->children[RIGHT]->color() == BLACK);
             }
 
             int left_black_height = check(n->children[LEFT]);
             int right_black_height = check(n->children[RIGHT]);
             assert(left_black_height == right_black_height); // same black height
 
-            return left_black_height + (n->color == BLACK ? 1 : 0);
+            return left_black_height + (n->color() == BLACK ? 1 : 0);
         };
         check(tree.node);
     }
 
+    void test_from_sorted()
+    {
+        for (int n = 0; n <= 2000; n += n < 70 ? 1 : 97)
+        {
+            vector<int> data(n);
+            for (int i = 0; i < n; ++i)
+                data[i] = 2 * i;
+
+            tree = RBTree<int>::from_sorted(data.begin(), data.end());
+            test_red_black_properties();
+            assert(!tree.node || (tree.node->color() == BLACK && tree.node->parent() == nullptr));
+            for (int i = 0; i < 2 * n; ++i)
+                assert(tree.find(i) == (i % 2 == 0));
+
+            // Still a working tree afterwards
+            for (int i = 1; i < 2 * n; i += 2)
+                assert(tree.add(i));
+            test_red_black_properties();
+            for (int i = 0; i < 2 * n; i += 2)
+                assert(tree.remove(i));
+            test_red_black_properties();
+        }
+        cout << "✅ Bulk load from sorted data passed.\n";
+    }
+
+    // Same behaviour through global new/delete and through the pool with non-trivial values
+    template <typename Tree, typename Make>
+    static void check_against_set(Make make)
+    {
+        Tree tree;
+        std::set<int> std_set;
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> dist(0, 2000);
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            int val = dist(rng);
+            int op = rng() % 3;
+            if (op == 0)
+                assert(tree.add(make(val)) == std_set.insert(val).second);
+            else if (op == 1)
+                assert(tree.find(make(val)) == (std_set.count(val) > 0));
+            else
+                assert(tree.remove(make(val)) == (std_set.erase(val) > 0));
+        }
+
+        Tree copied = tree, moved = std::move(tree);
+        for (int val = 0; val <= 2000; ++val)
+        {
+            assert(copied.find(make(val)) == (std_set.count(val) > 0));
+            assert(moved.find(make(val)) == (std_set.count(val) > 0));
+        }
+        copied.clear();
+        assert(!copied.find(make(*std_set.begin())) && moved.find(make(*std_set.begin())));
+        assert(copied.add(make(1)) && copied.find(make(1)));
+    }
+
+    void test_allocators()
+    {
+        check_against_set<RBTree<int, std::less<int>, std::allocator<int>>>([](int val) { return val; });
+        check_against_set<RBTree<std::string>>([](int val) { return std::string(40, 'k') + std::to_string(val); });
+        cout << "✅ Node allocators passed.\n";
+    }
+
+    void test_comparators()
+    {
+        check_against_set<RBTree<std::string, std::compare_three_way>>([](int val) { return std::string(40, 'k') + std::to_string(val); });
+        check_against_set<RBTree<int, std::greater<int>>>([](int val) { return val; });
+        cout << "✅ Comparators passed.\n";
+    }
+
+    void test_find_batch()
+    {
+        // Lengths around the lockstep group size, over an empty and a populated tree
+        std::mt19937 gen(3);
+        RBTree<int> tree;
+        std::set<int> model;
+        for (int round = 0; round < 2; ++round)
+        {
+            for (std::size_t length : {0, 1, 15, 16, 17, 1000})
+            {
+                std::vector<int> keys(length);
+                for (int &key : keys)
+                    key = gen() % 20000;
+                std::unique_ptr<bool[]> out(new bool[length + 1]);
+                tree.find_batch(std::span<const int>(keys), std::span<bool>(out.get(), length));
+                for (std::size_t i = 0; i < length; ++i)
+                    assert(out[i] == model.contains(keys[i]));
+
+                // Coroutine lookups, from one task at a time to more than the scheduler's slots
+                for (std::size_t in_flight : {1, 3, 16, 1000})
+                {
+                    tree.find_interleaved(std::span<const int>(keys), std::span<bool>(out.get(), length), in_flight);
+                    for (std::size_t i = 0; i < length; ++i)
+                        assert(out[i] == model.contains(keys[i]));
+                }
+            }
+
+            for (int i = 0; i < 5000; ++i)
+            {
+                int val = gen() % 10000;
+                tree.add(val);
+                model.insert(val);
+            }
+        }
+        cout << "✅ find_batch and find_interleaved passed.\n";
+    }
+
+    void test_stats()
+    {
+        RBTree<int, std::less<int>, NodePool<int>, TreeStats> counted;
+        for (int x : {1, 2, 3})
+            counted.add(x);
+        assert(counted.stats().rotations == 1);
+
+        counted.reset_stats();
+        assert(counted.find(1) && !counted.find(4));
+        assert(counted.stats().visits == 4 && counted.stats().comparisons == 4);
+        cout << "✅ Stats passed.\n";
+    }
+
+    // Colour, parent links and search order of any layout - returns the black height
+    template <typename Tree>
+    static int check_layout(const typename Tree::TreeNode *n, const typename Tree::TreeNode *parent)
+    {
+        if (!n)
+            return 1;
+
+        assert(n->parent() == parent);
+        assert(n->color() == RED || n->color() == BLACK);
+        if (n->color() == RED)
+            assert(!Tree::is_red(n->children[LEFT]) && !Tree::is_red(n->children[RIGHT]));
+        if (n->children[LEFT])
+            assert(n->children[LEFT]->val < n->val);
+        if (n->children[RIGHT])
+            assert(n->val < n->children[RIGHT]->val);
+
+        int left_black_height = check_layout<Tree>(n->children[LEFT], n);
+        assert(left_black_height == check_layout<Tree>(n->children[RIGHT], n));
+        return left_black_height + (n->color() == BLACK ? 1 : 0);
+    }
+
+    void test_packed_layout()
+    {
+        // The colour moves into the parent pointer - an 8-byte key no longer drags a padded colour field along
+        static_assert(sizeof(RBTree<long, std::less<long>, NodePool<long>, NoStats, PackedLayout>::TreeNode) == 4 * sizeof(void *));
+        static_assert(sizeof(RBTree<long, std::less<long>, NodePool<long>, NoStats, PackedLayout>::TreeNode) < sizeof(RBTree<long>::TreeNode));
+
+        using Packed = RBTree<int, std::less<int>, NodePool<int>, NoStats, PackedLayout>;
+        check_against_set<Packed>([](int val) { return val; });
+        check_against_set<RBTree<std::string, std::less<std::string>, std::allocator<std::string>, NoStats, PackedLayout>>([](int val) { return std::to_string(val); });
+
+        std::mt19937 gen(5);
+        Packed tree;
+        std::set<int> model;
+        for (int i = 0; i < 20000; ++i)
+        {
+            int val = gen() % 3000;
+            if (gen() % 3)
+                assert(tree.add(val) == model.insert(val).second);
+            else
+                assert(tree.remove(val) == (model.erase(val) > 0));
+            if (i % 1000 == 0)
+                check_layout<Packed>(tree.node, nullptr);
+        }
+        assert(!Packed::is_red(tree.node));
+        check_layout<Packed>(tree.node, nullptr);
+
+        std::vector<int> data(model.begin(), model.end());
+        Packed bulk = Packed::from_sorted(data.begin(), data.end()), copy = bulk;
+        check_layout<Packed>(bulk.node, nullptr);
+        check_layout<Packed>(copy.node, nullptr);
+        cout << "✅ Packed node layout passed.\n";
+    }
+
     void test_large_scale_inserts_deletes(int N = 1'000'000)
     {
         tree.clear();
@@ -271,6 +477,191 @@ public:
     }
 };
 
+class ConcurrentRBTreeTester
+{
+public:
+    // Single-threaded model check, with the invariants re-checked as the tree grows and shrinks
+    static void test_random_operations(int samples = 50'000)
+    {
+        ConcurrentRBTree<int> tree;
+        std::set<int> model;
+        std::mt19937 gen(5);
+        std::uniform_int_distribution<int> dist(0, 5000);
+
+        for (int i = 0; i < samples; ++i)
+        {
+            int val = dist(gen);
+            switch (gen() % 3)
+            {
+            case 0:
+                assert(tree.add(val) == model.insert(val).second);
+                break;
+            case 1:
+                assert(tree.find(val) == model.contains(val));
+                break;
+            default:
+                assert(tree.remove(val) == (model.erase(val) > 0));
+                break;
+            }
+
+            if (i % 1000 == 0)
+                assert(validate(tree) == model.size());
+        }
+
+        assert(validate(tree) == model.size());
+        for (int val : std::vector<int>(model.begin(), model.end()))
+            assert(tree.remove(val));
+        assert(validate(tree) == 0 && !tree.find(*model.begin()));
+        cout << "✅ Concurrent random operations passed.\n";
+    }
+
+    // Writers own disjoint keys (k % writers == t) and keep a private model of them, while readers look up
+    // a preloaded range nobody removes - every one of those lookups has to hit, whichever version they walk
+    static void test_stress(int writers = 2, int readers = 4, int ops = 20'000)
+    {
+        ConcurrentRBTree<int> tree;
+        const int stable = 2000, range = 20000;
+        for (int i = 0; i < stable; ++i)
+            tree.add(-1 - i);
+
+        std::vector<std::set<int>> models(writers);
+        std::atomic<bool> done{false};
+        std::atomic<long> reader_misses{0};
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < writers; ++t)
+            threads.emplace_back([&, t]
+            {
+                std::mt19937 gen(100 + t);
+                for (int i = 0; i < ops; ++i)
+                {
+                    int val = static_cast<int>(gen() % (range / writers)) * writers + t;
+                    if (gen() % 3)
+                        assert(tree.add(val) == models[t].insert(val).second);
+                    else
+                        assert(tree.remove(val) == (models[t].erase(val) > 0));
+                }
+            });
+
+        for (int r = 0; r < readers; ++r)
+            threads.emplace_back([&, r]
+            {
+                std::mt19937 gen(200 + r);
+                while (!done.load(std::memory_order_relaxed))
+                    if (!tree.find(-1 - static_cast<int>(gen() % stable)))
+                        reader_misses++;
+            });
+
+        for (int t = 0; t < writers; ++t)
+            threads[t].join();
+        done = true;
+        for (std::size_t t = writers; t < threads.size(); ++t)
+            threads[t].join();
+
+        assert(reader_misses == 0);
+        std::size_t expected = stable;
+        for (int t = 0; t < writers; ++t)
+        {
+            expected += models[t].size();
+            for (int val = t; val < range; val += writers)
+                assert(tree.find(val) == models[t].contains(val));
+        }
+        assert(validate(tree) == expected);
+
+        // With no reader pinned, every write moves the epoch on, so the backlog drains within two writes
+        for (int i = 0; i < 3; ++i)
+            tree.add(range + i);
+        assert(tree.retired.size() < 3 * 64);
+        cout << "✅ Concurrent stress passed.\n";
+    }
+
+    // Two trees share EpochDomain::global() but not a writer lock, so each one's writes advance the epoch
+    // under the other's readers - a reader that walks one tree while the other moves the epoch on must still
+    // never land on a freed node (ASan catches it if it does) or miss a key nobody removes
+    static void test_shared_domain(int readers = 4, int ops = 20'000)
+    {
+        ConcurrentRBTree<int> trees[2];
+        const int stable = 1000, range = 5000;
+        for (auto &tree : trees)
+            for (int i = 0; i < stable; ++i)
+                tree.add(-1 - i);
+
+        std::atomic<bool> done{false};
+        std::atomic<long> reader_misses{0};
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 2; ++t)
+            threads.emplace_back([&, t]
+            {
+                std::mt19937 gen(300 + t);
+                for (int i = 0; i < ops; ++i)
+                {
+                    int val = static_cast<int>(gen() % range);
+                    if (gen() % 2)
+                        trees[t].add(val);
+                    else
+                        trees[t].remove(val);
+                }
+            });
+
+        for (int r = 0; r < readers; ++r)
+            threads.emplace_back([&, r]
+            {
+                std::mt19937 gen(400 + r);
+                while (!done.load(std::memory_order_relaxed))
+                    if (!trees[r % 2].find(-1 - static_cast<int>(gen() % stable)))
+                        reader_misses++;
+            });
+
+        for (int t = 0; t < 2; ++t)
+            threads[t].join();
+        done = true;
+        for (std::size_t t = 2; t < threads.size(); ++t)
+            threads[t].join();
+
+        assert(reader_misses == 0);
+        for (auto &tree : trees)
+            assert(validate(tree) >= static_cast<std::size_t>(stable));
+        cout << "✅ Concurrent shared epoch domain passed.\n";
+    }
+
+private:
+    // Search order, no red right child or red-red pair, equal black height on every path, and every node
+    // sealed by the write that created it - returns the number of keys
+    template <typename T>
+    static std::size_t validate(const ConcurrentRBTree<T> &tree)
+    {
+        using TreeNode = typename ConcurrentRBTree<T>::TreeNode;
+        int black_height = -1;
+        std::size_t keys = 0;
+
+        auto walk = [&](auto walk, const TreeNode *node, const T *lo, const T *hi, int blacks) -> void
+        {
+            if (node == nullptr)
+            {
+                assert(black_height == -1 || black_height == blacks);
+                black_height = blacks;
+                return;
+            }
+
+            keys++;
+            assert(node->version <= tree.version);
+            assert(lo == nullptr || *lo < node->val);
+            assert(hi == nullptr || node->val < *hi);
+            assert(!ConcurrentRBTree<T>::is_red(node->children[RIGHT]));
+            assert(node->color == BLACK || !ConcurrentRBTree<T>::is_red(node->children[LEFT]));
+            blacks += node->color == BLACK;
+            walk(walk, node->children[LEFT], lo, &node->val, blacks);
+            walk(walk, node->children[RIGHT], &node->val, hi, blacks);
+        };
+
+        const TreeNode *root = tree.root.load();
+        assert(!ConcurrentRBTree<T>::is_red(root));
+        walk(walk, root, nullptr, nullptr, 0);
+        return keys;
+    }
+};
+
 int main()
 {
     RBTreeTest tester;
@@ -280,6 +671,16 @@ int main()
     // tester.test_node_with_two_children();
     // tester.test_inorder_traversal();
     // tester.test_red_black_properties();
+    tester.test_try_add();
+    tester.test_from_sorted();
+    tester.test_allocators();
+    tester.test_comparators();
+    tester.test_stats();
+    tester.test_find_batch();
+    tester.test_packed_layout();
+    ConcurrentRBTreeTester::test_random_operations();
+    ConcurrentRBTreeTester::test_stress();
+    ConcurrentRBTreeTester::test_shared_domain();
     tester.test_large_scale_inserts_deletes(1'000'000);
     tester.test_randomized_operations(1'000'000);
     cout << "🎉 All tests passed successfully.\n";
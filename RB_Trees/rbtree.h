@@ -2,9 +2,24 @@
 #define __RBTREE_H__
 
 #include <utility>
+#include <span>
+#include <cassert>
+#include <algorithm>
 #include <functional>
 #include <stack>
 #include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+#include "../Common/node_pool.h"
+#include "../Common/compare.h"
+#include "../Common/memory_usage.h"
+#include "../Common/instrumentation.h"
+#include "../Common/prefetch.h"
+#include "../Common/lookup_task.h"
+#include "../Common/node_layout.h"
+#include <bit>
 
 enum color_t
 {
@@ -18,7 +33,7 @@ enum dir_t
     RIGHT
 };
 
-template <typename T, typename Compare = std::less<T>>
+template <typename T, typename Compare = std::less<T>, typename Alloc = NodePool<T>, typename Stats = NoStats, typename Layout = PlainLayout>
 class RBTree
 {
 public:
@@ -26,7 +41,7 @@ public:
     RBTree() : node(nullptr) {}
     RBTree(const T &val)
     {
-        node = new TreeNode(val);
+        node = create_node(val);
     }
 
     // Destructor
@@ -36,16 +51,16 @@ public:
     }
 
     // Copy
-    RBTree(const RBTree &other)
+    RBTree(const RBTree &other) : alloc(NodeTraits::select_on_container_copy_construction(other.alloc))
     {
-        auto copy = [](auto copy, const TreeNode *root, const TreeNode *parent)
+        auto copy = [this](auto copy, const TreeNode *root, TreeNode *parent) -> TreeNode *
         {
             if (root == nullptr)
                 return nullptr;
-            TreeNode *ret = new TreeNode;
-            ret->parent = parent;
+            TreeNode *ret = create_node();
+            ret->set_parent(parent);
             ret->val = root->val;
-            ret->color = root->color;
+            ret->set_color(root->color());
             ret->children[LEFT] = copy(copy, root->children[LEFT], ret);
             ret->children[RIGHT] = copy(copy, root->children[RIGHT], ret);
             return ret;
@@ -62,11 +77,12 @@ public:
         RBTree new_tree(other);
         std::swap(node, new_tree.node);
         std::swap(less_than, new_tree.less_than);
+        std::swap(alloc, new_tree.alloc);
         return *this;
     }
 
     // Move
-    RBTree(RBTree &&other) noexcept : node(other.node), less_than(std::move(other.less_than))
+    RBTree(RBTree &&other) noexcept : node(other.node), less_than(std::move(other.less_than)), alloc(std::move(other.alloc))
     {
         other.node = nullptr;
     }
@@ -79,42 +95,121 @@ public:
         clear(node);
         node = other.node;
 	less_than = std::move(less_than);
+        alloc = std::move(other.alloc);
         other.node = nullptr;
         return *this;
     }
 
+    // Bulk load from a sorted, duplicate-free range in O(n)
+    // Subtree sizes differ by at most one, so every level above the deepest is full - colouring just
+    // the deepest level red (when it is not full) gives every path the same black height
+    template <std::forward_iterator It>
+    static RBTree from_sorted(It first, It last)
+    {
+        std::size_t n = std::distance(first, last);
+        int red_depth = std::has_single_bit(n + 1) ? -1 : std::bit_width(n) - 1;
+
+        RBTree tree;
+        auto build = [&](auto build, std::size_t n, int depth, TreeNode *parent) -> TreeNode *
+        {
+            if (n == 0)
+                return nullptr;
+
+            TreeNode *ret = tree.create_node();
+            ret->set_parent(parent);
+            ret->set_color(depth == red_depth ? RED : BLACK);
+            ret->children[LEFT] = build(build, (n - 1) / 2, depth + 1, ret);
+            ret->val = *first;
+            ++first;
+            ret->children[RIGHT] = build(build, n - 1 - (n - 1) / 2, depth + 1, ret);
+            return ret;
+        };
+
+        tree.node = build(build, n, 0, nullptr);
+        return tree;
+    }
+
     // Search
     bool find(const T &val) const
     {
-        for (TreeNode *search = node; search; search = search->children[look(val, search)])
-            if (search->val == val)
+        for (TreeNode *search = node; search;)
+        {
+            std::weak_ordering cmp = compare(val, search);
+            if (cmp == 0)
                 return true;
+            search = cmp < 0 ? search->children[LEFT] : search->children[RIGHT];
+        }
 
         return false;
     }
 
+    // Batched search - out[i] = find(keys[i]), FIND_BATCH_GROUP descents at a time in lockstep (run_lockstep)
+    void find_batch(std::span<const T> keys, std::span<bool> out) const
+    {
+        run_lockstep(keys, out, static_cast<const TreeNode *>(node), [this](const T &val, const TreeNode *root, bool &found) -> const TreeNode *
+        {
+            std::weak_ordering cmp = compare(val, root);
+            found = cmp == 0;
+            return root->children[cmp < 0 ? LEFT : RIGHT];
+        });
+    }
+
+    // Coroutine lookup - suspends after prefetching each node on the way down; val must outlive the task
+    LookupTask find_task(const T &val) const
+    {
+        for (const TreeNode *search = node; search;)
+        {
+            std::weak_ordering cmp = compare(val, search);
+            if (cmp == 0)
+                co_return true;
+
+            search = cmp < 0 ? search->children[LEFT] : search->children[RIGHT];
+            if (search)
+                co_await prefetched{search};
+        }
+
+        co_return false;
+    }
+
+    // The same lookups as coroutines, in_flight of them interleaved by a round-robin scheduler
+    void find_interleaved(std::span<const T> keys, std::span<bool> out, std::size_t in_flight = FIND_BATCH_GROUP) const
+    {
+        run_interleaved(keys, out, in_flight, [this](const T &val) { return find_task(val); });
+    }
+
     // Insert
     bool add(const T &val)
     {
-        if (find(val))
-            return false;
+        return try_add(val).second;
+    }
 
-        // Insert
+    // Insert in a single descent, returning where val is stored and whether it was added
+    // The pointer stays valid until the next remove (which may move values between nodes)
+    std::pair<const T *, bool> try_add(const T &val)
+    {
+        // Duplicates are caught on the way down
         TreeNode *ins_par = nullptr;
-        for (TreeNode *ins = node; ins; ins_par = ins, ins = ins->children[look(val, ins)])
-            ;
+        dir_t dir = LEFT;
+        for (TreeNode *ins = node; ins; ins_par = ins, ins = ins->children[dir])
+        {
+            std::weak_ordering cmp = compare(val, ins);
+            if (cmp == 0)
+                return {&ins->val, false};
+            dir = cmp < 0 ? LEFT : RIGHT;
+        }
 
-        TreeNode *ins_node = new TreeNode(val);
-        ins_node->parent = ins_par;
+        TreeNode *ins_node = create_node(val);
+        ins_node->set_parent(ins_par);
+        const T *stored = &ins_node->val;
 
         if (ins_par == nullptr) // No nodes - Case 0
         {
             node = ins_node;
-            node->color = BLACK;
-            return true;
+            node->set_color(BLACK);
+            return {stored, true};
         }
         else // Insert as child to parent
-            ins_par->children[look(val, ins_par)] = ins_node;
+            ins_par->children[dir] = ins_node;
 
         // Balance
         // Case 1 -> parent is root and is red
@@ -124,9 +219,9 @@ public:
         // If parent is black, no balancing
         while (is_red(ins_par))
         {
-            if (ins_par->parent == nullptr) // Case 1
+            if (ins_par->parent() == nullptr) // Case 1
             {
-                ins_par->color = BLACK;
+                ins_par->set_color(BLACK);
             }
 
             else
@@ -134,56 +229,57 @@ public:
                 TreeNode *ins_uncle = sibling(ins_par);
                 if (is_red(ins_uncle)) // Case 2
                 {
-                    ins_uncle->color = BLACK;
-                    ins_par->color = BLACK;
-                    ins_par->parent->color = RED;
-                    ins_node = ins_par->parent;
-                    ins_par = ins_node->parent;
+                    ins_uncle->set_color(BLACK);
+                    ins_par->set_color(BLACK);
+                    ins_par->parent()->set_color(RED);
+                    ins_node = ins_par->parent();
+                    ins_par = ins_node->parent();
                 }
 
                 else
                 {
-                    if (ins_par->children[LEFT] == ins_node && ins_par->parent->children[LEFT] == ins_par) // Case 4A
+                    if (ins_par->children[LEFT] == ins_node && ins_par->parent()->children[LEFT] == ins_par) // Case 4A
                     {
-                        ins_par->color = BLACK;
-                        ins_par->parent->color = RED;
-                        right_rotate(ins_par->parent->parent, ins_par->parent, ins_par);
+                        ins_par->set_color(BLACK);
+                        ins_par->parent()->set_color(RED);
+                        right_rotate(ins_par->parent()->parent(), ins_par->parent(), ins_par);
                     }
 
-                    else if (ins_par->children[RIGHT] == ins_node && ins_par->parent->children[RIGHT] == ins_par) // Case 4B
+                    else if (ins_par->children[RIGHT] == ins_node && ins_par->parent()->children[RIGHT] == ins_par) // Case 4B
                     {
-                        ins_par->color = BLACK;
-                        ins_par->parent->color = RED;
-                        left_rotate(ins_par->parent->parent, ins_par->parent, ins_par);
+                        ins_par->set_color(BLACK);
+                        ins_par->parent()->set_color(RED);
+                        left_rotate(ins_par->parent()->parent(), ins_par->parent(), ins_par);
                     }
 
-                    else if (ins_par->children[LEFT] == ins_node && ins_par->parent->children[RIGHT] == ins_par) // Case 3A
+                    else if (ins_par->children[LEFT] == ins_node && ins_par->parent()->children[RIGHT] == ins_par) // Case 3A
                     {
-                        right_rotate(ins_par->parent, ins_par, ins_node);
+                        right_rotate(ins_par->parent(), ins_par, ins_node);
                         ins_node = ins_par;
-                        ins_par = ins_node->parent;
+                        ins_par = ins_node->parent();
                     }
 
                     else // Case 3B
                     {
-                        left_rotate(ins_par->parent, ins_par, ins_node);
+                        left_rotate(ins_par->parent(), ins_par, ins_node);
                         ins_node = ins_par;
-                        ins_par = ins_node->parent;
+                        ins_par = ins_node->parent();
                     }
                 }
             }
         }
 
         if (ins_par == nullptr)
-            ins_node->color = BLACK;
-        return true;
+            ins_node->set_color(BLACK);
+        return {stored, true};
     }
 
     // Delete
     bool remove(const T &val)
     {
         TreeNode *del_node = node;
-        for (; del_node && !(del_node->val == val); del_node = del_node->children[look(val, del_node)])
+        std::weak_ordering cmp = std::weak_ordering::equivalent;
+        for (; del_node && (cmp = compare(val, del_node)) != 0; del_node = del_node->children[cmp < 0 ? LEFT : RIGHT])
             ;
 
         if (del_node == nullptr) // Value not in tree
@@ -205,23 +301,23 @@ public:
             if (del_node == node)
             {
                 node = del_node->children[child_dir];
-                del_node->children[child_dir]->parent = nullptr;
+                del_node->children[child_dir]->set_parent(nullptr);
             }
 
-            else if (del_node->parent->children[LEFT] == del_node)
+            else if (del_node->parent()->children[LEFT] == del_node)
             {
-                del_node->parent->children[LEFT] = del_node->children[child_dir];
-                del_node->children[child_dir]->parent = del_node->parent;
+                del_node->parent()->children[LEFT] = del_node->children[child_dir];
+                del_node->children[child_dir]->set_parent(del_node->parent());
             }
 
             else
             {
-                del_node->parent->children[RIGHT] = del_node->children[child_dir];
-                del_node->children[child_dir]->parent = del_node->parent;
+                del_node->parent()->children[RIGHT] = del_node->children[child_dir];
+                del_node->children[child_dir]->set_parent(del_node->parent());
             }
 
-            del_node->children[child_dir]->color = BLACK;
-            delete del_node;
+            del_node->children[child_dir]->set_color(BLACK);
+            destroy_node(del_node);
             return true;
         };
 
@@ -238,15 +334,15 @@ public:
             if (del_node == node)
             {
                 node = nullptr;
-                delete del_node;
+                destroy_node(del_node);
                 return true;
             }
 
             // Red
             else if (is_red(del_node))
             {
-                del_node->parent->children[del_node->parent->children[LEFT] == del_node ? LEFT : RIGHT] = nullptr;
-                delete del_node;
+                del_node->parent()->children[del_node->parent()->children[LEFT] == del_node ? LEFT : RIGHT] = nullptr;
+                destroy_node(del_node);
                 return true;
             }
 
@@ -254,7 +350,7 @@ public:
             else
             {
                 black_leaf_delete(del_node);
-                delete del_node;
+                destroy_node(del_node);
                 return true;
             }
         }
@@ -266,44 +362,145 @@ public:
         node = nullptr;
     }
 
+    // Node counts and bytes held by nodes - one key per node, so fill is always 1
+    MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage;
+        if constexpr (reserving_allocator<NodeAlloc>)
+            usage.reserved = alloc.reserved();
+        if (node == nullptr)
+            return usage;
+
+        std::stack<const TreeNode *> st;
+        st.push(node);
+
+        while (!st.empty())
+        {
+            const TreeNode *top = st.top();
+            st.pop();
+
+            usage.nodes++;
+            if (top->children[LEFT])
+                st.push(top->children[LEFT]);
+            if (top->children[RIGHT])
+                st.push(top->children[RIGHT]);
+            if (top->children[LEFT] || top->children[RIGHT])
+                usage.internals++;
+            else
+                usage.leaves++;
+        }
+
+        usage.keys = usage.nodes;
+        usage.bytes = usage.nodes * sizeof(TreeNode);
+        usage.fill = 1;
+        return usage;
+    }
+
+    // Instrumentation counters - all zero-cost no-ops unless the tree was instantiated with a counting policy
+    const Stats &stats() const { return counters; }
+    void reset_stats() { counters.reset(); }
+
 private: // Members
+    static constexpr bool PACKED = Layout::PACKED;
+    struct NoColor
+    {
+    };
+
+    // Packed, the colour is the low bit of the parent pointer - find never reads either, so the only cost
+    // is a mask on the rebalancing paths
     struct TreeNode
     {
         T val;
-        color_t color;
+        [[no_unique_address]] std::conditional_t<PACKED, NoColor, color_t> stored_color;
         TreeNode *children[2];
-        TreeNode *parent;
+        std::conditional_t<PACKED, TaggedPtr<TreeNode, 1>, TreeNode *> parent_link;
 
-        TreeNode() : val(), color(RED), parent(nullptr)
+        TreeNode() : val(), parent_link(nullptr)
         {
             children[LEFT] = nullptr;
             children[RIGHT] = nullptr;
+            set_color(RED);
         }
 
-        TreeNode(const T &val) : val(val), color(RED), parent(nullptr)
+        TreeNode(const T &val) : val(val), parent_link(nullptr)
         {
             children[LEFT] = nullptr;
             children[RIGHT] = nullptr;
+            set_color(RED);
+        }
+
+        TreeNode *parent() const
+        {
+            if constexpr (PACKED)
+                return parent_link.ptr();
+            else
+                return parent_link;
+        }
+
+        void set_parent(TreeNode *parent)
+        {
+            if constexpr (PACKED)
+                parent_link.set_ptr(parent);
+            else
+                parent_link = parent;
+        }
+
+        color_t color() const
+        {
+            if constexpr (PACKED)
+                return static_cast<color_t>(parent_link.tag());
+            else
+                return stored_color;
+        }
+
+        void set_color(color_t color)
+        {
+            if constexpr (PACKED)
+                parent_link.set_tag(color);
+            else
+                stored_color = color;
         }
     };
 
     TreeNode *node;
     Compare less_than;
 
+    using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<TreeNode>;
+    using NodeTraits = std::allocator_traits<NodeAlloc>;
+    NodeAlloc alloc;
+    [[no_unique_address]] mutable Stats counters;
+
 private: // Functions
-    inline dir_t look(const T &val, TreeNode *node) const
+    // Compares val against a node on the way down - where visits and comparisons are counted
+    std::weak_ordering compare(const T &val, const TreeNode *n) const
     {
-        return less_than(val, node->val) ? LEFT : RIGHT;
+        counters.visit();
+        counters.comparison();
+        return three_way(less_than, val, n->val);
     }
 
     static inline bool is_red(TreeNode *node)
     {
-        return node && node->color == RED;
+        return node && node->color() == RED;
     }
 
     static inline TreeNode *sibling(TreeNode *node)
     {
-        return node->parent->children[node->parent->children[LEFT] == node ? RIGHT : LEFT];
+        return node->parent()->children[node->parent()->children[LEFT] == node ? RIGHT : LEFT];
+    }
+
+    template <typename... Args>
+    TreeNode *create_node(Args &&...args)
+    {
+        TreeNode *ret = NodeTraits::allocate(alloc, 1);
+        NodeTraits::construct(alloc, ret, std::forward<Args>(args)...);
+        return ret;
+    }
+
+    void destroy_node(TreeNode *node)
+    {
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
     }
 
     void clear(TreeNode *node)
@@ -311,6 +508,13 @@ private: // Functions
         if (node == nullptr)
             return;
 
+        // Pooled nodes with nothing to destruct are dropped a slab at a time - no traversal
+        if constexpr (releasable_allocator<NodeAlloc> && std::is_trivially_destructible_v<TreeNode>)
+        {
+            alloc.release();
+            return;
+        }
+
         std::stack<TreeNode *> st;
         st.push(node);
 
@@ -334,7 +538,7 @@ private: // Functions
 
             else
             {
-                delete top;
+                destroy_node(top);
                 st.pop();
             }
         }
@@ -342,48 +546,50 @@ private: // Functions
 
     void left_rotate(TreeNode *gp, TreeNode *p, TreeNode *n)
     {
+        counters.rotation();
         if (gp == nullptr) // Parent is root
         {
             node = n;
-            n->parent = nullptr;
+            n->set_parent(nullptr);
         }
         else
         {
             gp->children[gp->children[RIGHT] == p ? RIGHT : LEFT] = n;
-            n->parent = gp;
+            n->set_parent(gp);
         }
 
         p->children[RIGHT] = n->children[LEFT];
         if (n->children[LEFT])
-            n->children[LEFT]->parent = p;
+            n->children[LEFT]->set_parent(p);
         n->children[LEFT] = p;
-        p->parent = n;
+        p->set_parent(n);
     }
 
     void right_rotate(TreeNode *gp, TreeNode *p, TreeNode *n)
     {
+        counters.rotation();
         if (gp == nullptr) // Parent is root
         {
             node = n;
-            n->parent = nullptr;
+            n->set_parent(nullptr);
         }
         else
         {
             gp->children[gp->children[RIGHT] == p ? RIGHT : LEFT] = n;
-            n->parent = gp;
+            n->set_parent(gp);
         }
 
         p->children[LEFT] = n->children[RIGHT];
         if (n->children[RIGHT])
-            n->children[RIGHT]->parent = p;
+            n->children[RIGHT]->set_parent(p);
         n->children[RIGHT] = p;
-        p->parent = n;
+        p->set_parent(n);
     }
 
     void black_leaf_delete(TreeNode *N)
     {
         // Only problem - violates RB Tree Properties - FIX!!
-        TreeNode *P = N->parent;
+        TreeNode *P = N->parent();
         TreeNode *S, *C, *D;
         dir_t dir = P->children[LEFT] == N ? LEFT : RIGHT;
         P->children[dir] = nullptr;
@@ -400,12 +606,12 @@ private: // Functions
             if (is_red(S))
             {
                 if (dir == LEFT)
-                    left_rotate(P->parent, P, S);
+                    left_rotate(P->parent(), P, S);
                 else
-                    right_rotate(P->parent, P, S);
+                    right_rotate(P->parent(), P, S);
 
-                P->color = RED;
-                S->color = BLACK;
+                P->set_color(RED);
+                S->set_color(BLACK);
                 S = C;
 
                 D = S->children[1 - dir];
@@ -416,8 +622,8 @@ private: // Functions
                 if (is_red(C))
                     goto D5;
 
-                S->color = RED;
-                P->color = BLACK;
+                S->set_color(RED);
+                P->set_color(BLACK);
                 return;
             }
 
@@ -429,14 +635,14 @@ private: // Functions
 
             if (is_red(P))
             {
-                S->color = RED;
-                P->color = BLACK;
+                S->set_color(RED);
+                P->set_color(BLACK);
                 return;
             }
 
-            S->color = RED;
+            S->set_color(RED);
             N = P;
-        } while (P = N->parent);
+        } while (P = N->parent());
 
     if (!P) // Only change from Wikipedia article - fitting to be on 437
         return;
@@ -446,19 +652,19 @@ private: // Functions
             left_rotate(P, S, C);
         else
             right_rotate(P, S, C);
-        S->color = RED;
-        C->color = BLACK;
+        S->set_color(RED);
+        C->set_color(BLACK);
         D = S;
         S = C;
 
     D6:
         if (dir == LEFT)
-            left_rotate(P->parent, P, S);
+            left_rotate(P->parent(), P, S);
         else
-            right_rotate(P->parent, P, S);
-        S->color = P->color;
-        P->color = BLACK;
-        D->color = BLACK;
+            right_rotate(P->parent(), P, S);
+        S->set_color(P->color());
+        P->set_color(BLACK);
+        D->set_color(BLACK);
         return;
     }
 
@@ -5,7 +5,13 @@
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <bit>
+#include <string>
+#include <span>
+#include <memory>
+#include <map>
 #include "splay_tree.h"
+#include "splay_cache.h"
 
 using namespace std;
 
@@ -24,12 +30,12 @@ private:
         if (node == nullptr)
             return true;
 
-        if (node->children[LEFT] && node->children[LEFT]->val > node->val)
+        if (node->children[D_LEFT] && node->children[D_LEFT]->val > node->val)
             return false;
-        if (node->children[RIGHT] && node->children[RIGHT]->val < node->val)
+        if (node->children[D_RIGHT] && node->children[D_RIGHT]->val < node->val)
             return false;
 
-        return is_bst_valid<T, Compare>(node->children[LEFT]) && is_bst_valid<T, Compare>(node->children[RIGHT]);
+        return is_bst_valid<T, Compare>(node->children[D_LEFT]) && is_bst_valid<T, Compare>(node->children[D_RIGHT]);
     }
 
     template <typename T, typename Compare>
@@ -41,7 +47,7 @@ private:
         if (node->parent != parent)
             return false;
 
-        return is_parent_pointers_valid<T, Compare>(node->children[LEFT], node) && is_parent_pointers_valid<T, Compare>(node->children[RIGHT], node);
+        return is_parent_pointers_valid<T, Compare>(node->children[D_LEFT], node) && is_parent_pointers_valid<T, Compare>(node->children[D_RIGHT], node);
     }
 
 public:
@@ -57,6 +63,15 @@ public:
         test_clear();
         test_large_data_set();
         test_random_operations();
+        test_from_sorted();
+        test_allocators();
+        test_comparators();
+        test_stats();
+        test_find_batch();
+        test_top_down();
+        test_policies();
+        test_finger();
+        test_splay_cache();
         test_performance_comparison();
         cout << "All SplayTree tests passed!" << endl;
     }
@@ -362,6 +377,419 @@ public:
         cout << "test_random_operations passed." << endl;
     }
 
+    static void test_from_sorted()
+    {
+        for (int n = 0; n <= 2000; n += n < 70 ? 1 : 97)
+        {
+            vector<int> data(n);
+            for (int i = 0; i < n; ++i)
+                data[i] = 2 * i;
+
+            SplayTree<int> st = SplayTree<int>::from_sorted(data.begin(), data.end());
+            assert(is_splay_tree_valid(st));
+
+            // Perfectly balanced before the first access
+            auto height = [](auto height, const typename SplayTree<int>::TreeNode *node) -> int
+            {
+                return node ? 1 + max(height(height, node->children[D_LEFT]), height(height, node->children[D_RIGHT])) : 0;
+            };
+            assert(height(height, st.node) == static_cast<int>(std::bit_width(static_cast<unsigned>(n))));
+
+            for (int i = 0; i < 2 * n; ++i)
+                assert(st.find(i) == (i % 2 == 0));
+            assert(is_splay_tree_valid(st));
+        }
+
+        cout << "test_from_sorted passed." << endl;
+    }
+
+    // Same behaviour through global new/delete and through the pool with non-trivial values
+    template <typename Tree, typename Make>
+    static void check_against_set(Make make)
+    {
+        Tree tree;
+        std::set<int> std_set;
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> dist(0, 2000);
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            int val = dist(rng);
+            int op = rng() % 3;
+            if (op == 0)
+                assert(tree.add(make(val)) == std_set.insert(val).second);
+            else if (op == 1)
+                assert(tree.find(make(val)) == (std_set.count(val) > 0));
+            else
+                assert(tree.remove(make(val)) == (std_set.erase(val) > 0));
+        }
+
+        Tree copied = tree, moved = std::move(tree);
+        for (int val = 0; val <= 2000; ++val)
+        {
+            assert(copied.find(make(val)) == (std_set.count(val) > 0));
+            assert(moved.find(make(val)) == (std_set.count(val) > 0));
+        }
+        copied.clear();
+        assert(!copied.find(make(*std_set.begin())) && moved.find(make(*std_set.begin())));
+        assert(copied.add(make(1)) && copied.find(make(1)));
+    }
+
+    static void test_allocators()
+    {
+        check_against_set<SplayTree<int, std::less<int>, std::allocator<int>>>([](int val) { return val; });
+        check_against_set<SplayTree<std::string>>([](int val) { return std::string(40, 'k') + std::to_string(val); });
+
+        cout << "test_allocators passed." << endl;
+    }
+
+    static void test_comparators()
+    {
+        check_against_set<SplayTree<std::string, std::compare_three_way>>([](int val) { return std::string(40, 'k') + std::to_string(val); });
+        check_against_set<SplayTree<int, std::greater<int>>>([](int val) { return val; });
+
+        cout << "test_comparators passed." << endl;
+    }
+
+    static void test_stats()
+    {
+        // Ascending inserts hang each key off the root's right, so every splay is a single zig
+        SplayTree<int, std::less<int>, NodePool<int>, TreeStats> tree;
+        for (int i = 1; i <= 10; ++i)
+            tree.add(i);
+        assert(tree.stats().splays == 9 && tree.stats().splay_depth == 9 && tree.stats().rotations == 9);
+
+        // ...which leaves 1 at the bottom of a left spine
+        tree.reset_stats();
+        assert(tree.find(1));
+        assert(tree.stats().visits == 10 && tree.stats().max_splay_depth == 9 && tree.stats().rotations == 9);
+
+        cout << "test_stats passed." << endl;
+    }
+
+    static void test_find_batch()
+    {
+        // Lengths around the lockstep group size, over an empty and a populated tree
+        std::mt19937 gen(3);
+        SplayTree<int> tree;
+        std::set<int> model;
+        for (int round = 0; round < 2; ++round)
+        {
+            for (std::size_t length : {0, 1, 15, 16, 17, 1000})
+            {
+                std::vector<int> keys(length);
+                for (int &key : keys)
+                    key = gen() % 20000;
+                std::unique_ptr<bool[]> out(new bool[length + 1]);
+                tree.find_batch(std::span<const int>(keys), std::span<bool>(out.get(), length));
+                for (std::size_t i = 0; i < length; ++i)
+                    assert(out[i] == model.contains(keys[i]));
+            }
+
+            for (int i = 0; i < 5000; ++i)
+            {
+                int val = gen() % 10000;
+                tree.add(val);
+                model.insert(val);
+            }
+        }
+        cout << "test_find_batch passed." << endl;
+    }
+
+    static void test_top_down()
+    {
+        using TopDown = SplayTree<int, std::less<int>, NodePool<int>, NoStats, TopDownSplay>;
+        static_assert(sizeof(TopDown::TreeNode) + sizeof(void *) == sizeof(SplayTree<int>::TreeNode));
+
+        check_against_set<TopDown>([](int val) { return val; });
+        check_against_set<SplayTree<std::string, std::less<std::string>, NodePool<std::string>, NoStats, TopDownSplay>>([](int val) { return std::string(40, 'k') + std::to_string(val); });
+        check_against_set<SplayTree<int, std::greater<int>, NodePool<int>, NoStats, TopDownSplay>>([](int val) { return val; });
+
+        // Every access leaves its key (or its neighbour on a miss) at the root of a valid search tree
+        auto in_order = [](auto in_order, const TopDown::TreeNode *node, std::vector<int> &out) -> void
+        {
+            if (node == nullptr)
+                return;
+            in_order(in_order, node->children[D_LEFT], out);
+            out.push_back(node->val);
+            in_order(in_order, node->children[D_RIGHT], out);
+        };
+
+        TopDown tree;
+        std::set<int> model;
+        std::mt19937 gen(11);
+        for (int i = 0; i < 2000; ++i)
+        {
+            int val = gen() % 500;
+            if (gen() % 4)
+            {
+                assert(tree.add(val) == model.insert(val).second);
+                assert(tree.node->val == val);
+            }
+            else if (tree.find(val))
+                assert(tree.node->val == val);
+            else
+                assert(!model.contains(val));
+
+            if (i % 100 == 0)
+            {
+                std::vector<int> keys;
+                in_order(in_order, tree.node, keys);
+                assert(std::equal(keys.begin(), keys.end(), model.begin(), model.end()));
+            }
+        }
+
+        // Ascending inserts each go in above the root, so nothing is rotated until the deep find
+        SplayTree<int, std::less<int>, NodePool<int>, TreeStats, TopDownSplay> counted;
+        for (int i = 1; i <= 10; ++i)
+            counted.add(i);
+        assert(counted.stats().rotations == 0 && counted.stats().splay_depth == 0);
+        counted.reset_stats();
+        assert(counted.find(1));
+        assert(counted.stats().visits == 10 && counted.stats().max_splay_depth == 9 && counted.stats().rotations == 4);
+
+        cout << "test_top_down passed." << endl;
+    }
+
+    // Search order and parent links of any engine or policy - returns the keys in order
+    template <typename Tree>
+    static std::vector<int> checked_keys(const Tree &tree)
+    {
+        std::vector<int> keys;
+        auto walk = [&](auto walk, const typename Tree::TreeNode *node, const typename Tree::TreeNode *parent) -> void
+        {
+            if (node == nullptr)
+                return;
+            if constexpr (requires { node->parent; })
+                assert(node->parent == parent);
+            walk(walk, node->children[D_LEFT], node);
+            keys.push_back(node->val);
+            walk(walk, node->children[D_RIGHT], node);
+        };
+        walk(walk, tree.node, nullptr);
+        assert(std::is_sorted(keys.begin(), keys.end()) && keys.size() == tree.count);
+        return keys;
+    }
+
+    template <typename Tree>
+    static void check_policy()
+    {
+        check_against_set<Tree>([](int val) { return val; });
+
+        Tree tree;
+        std::set<int> model;
+        std::mt19937 gen(17);
+        for (int i = 0; i < 5000; ++i)
+        {
+            int val = gen() % 1000;
+            switch (gen() % 3)
+            {
+            case 0:
+                assert(tree.add(val) == model.insert(val).second);
+                break;
+            case 1:
+                assert(tree.find(val) == model.contains(val));
+                break;
+            default:
+                assert(tree.remove(val) == (model.erase(val) > 0));
+                break;
+            }
+        }
+        std::vector<int> keys = checked_keys(tree);
+        assert(std::equal(keys.begin(), keys.end(), model.begin(), model.end()));
+    }
+
+    static void test_policies()
+    {
+        check_policy<SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, SemiSplay>>();
+        check_policy<SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, DepthSplay<>>>();
+        check_policy<SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, CountingSplay<4>>>();
+        check_policy<SplayTree<int, std::less<int>, NodePool<int>, NoStats, TopDownSplay, DepthSplay<>>>();
+        check_policy<SplayTree<int, std::less<int>, NodePool<int>, NoStats, TopDownSplay, CountingSplay<4>>>();
+
+        // Semi-splaying the bottom of a 10-node left spine takes fewer rotations and stops short of the root
+        SplayTree<int, std::less<int>, NodePool<int>, TreeStats, BottomUpSplay, SemiSplay> semi;
+        for (int i = 1; i <= 10; ++i)
+            semi.add(i);
+        semi.reset_stats();
+        assert(semi.find(1) && semi.node->val != 1);
+        assert(semi.stats().splays == 1 && semi.stats().rotations < 9);
+        checked_keys(semi);
+
+        // A balanced tree is under the depth threshold everywhere, so reads leave it untouched...
+        std::vector<int> data(1023);
+        for (int i = 0; i < 1023; ++i)
+            data[i] = i;
+        using Threshold = SplayTree<int, std::less<int>, NodePool<int>, TreeStats, BottomUpSplay, DepthSplay<>>;
+        Threshold balanced = Threshold::from_sorted(data.begin(), data.end());
+        const auto *root = balanced.node;
+        for (int val : data)
+            assert(balanced.find(val));
+        assert(balanced.node == root && balanced.stats().splays == 0);
+
+        // ...while ascending inserts grow a spine until one lands deep enough to be splayed
+        Threshold spine;
+        for (int i = 0; i < 100; ++i)
+            spine.add(i);
+        assert(spine.stats().splays > 0 && spine.stats().splays < 20);
+
+        // Every fourth access splays
+        using Counting = SplayTree<int, std::less<int>, NodePool<int>, TreeStats, BottomUpSplay, CountingSplay<4>>;
+        Counting counting = Counting::from_sorted(data.begin(), data.end());
+        for (int i = 0; i < 8; ++i)
+            assert(counting.find(i * 100));
+        assert(counting.stats().splays == 2);
+
+        cout << "test_policies passed." << endl;
+    }
+
+    template <typename Tree>
+    static void check_finger()
+    {
+        Tree tree;
+        std::set<int> model;
+        std::mt19937 gen(23);
+        int cursor = 0;
+        for (int i = 0; i < 20000; ++i)
+        {
+            // Mostly short hops from the previous key, with the odd jump and a plain find/add mixed in
+            cursor = gen() % 16 ? std::clamp(cursor + static_cast<int>(gen() % 9) - 4, 0, 2000) : static_cast<int>(gen() % 2001);
+            switch (gen() % 6)
+            {
+            case 0:
+            case 1:
+                assert(tree.add_near(cursor) == model.insert(cursor).second);
+                break;
+            case 2:
+            case 3:
+                assert(tree.find_near(cursor) == model.contains(cursor));
+                break;
+            case 4:
+                assert(tree.remove(cursor) == (model.erase(cursor) > 0));
+                break;
+            default:
+                assert(tree.find(cursor) == model.contains(cursor));
+                break;
+            }
+        }
+        std::vector<int> keys = checked_keys(tree);
+        assert(std::equal(keys.begin(), keys.end(), model.begin(), model.end()));
+
+        tree.clear();
+        assert(!tree.find_near(1) && tree.add_near(1) && tree.find_near(1));
+    }
+
+    static void test_finger()
+    {
+        check_finger<SplayTree<int>>();
+        check_finger<SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, SemiSplay>>();
+        check_finger<SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, DepthSplay<>>>();
+        check_finger<SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, CountingSplay<4>>>();
+        check_finger<SplayTree<int, std::less<int>, NodePool<int>, NoStats, TopDownSplay>>();
+
+        // A sequential pass over a tree the policy leaves alone - from the root every lookup walks the
+        // full height, from the finger most are a step or two
+        std::vector<int> data(1 << 14);
+        for (int i = 0; i < (1 << 14); ++i)
+            data[i] = i;
+        using Threshold = SplayTree<int, std::less<int>, NodePool<int>, TreeStats, BottomUpSplay, DepthSplay<>>;
+        Threshold from_root = Threshold::from_sorted(data.begin(), data.end()), from_finger = Threshold::from_sorted(data.begin(), data.end());
+        for (int val : data)
+        {
+            assert(from_root.find(val));
+            assert(from_finger.find_near(val));
+        }
+        assert(from_finger.stats().comparisons * 2 < from_root.stats().comparisons);
+
+        cout << "test_finger passed." << endl;
+    }
+
+    static void test_splay_cache()
+    {
+        // Random traffic against a map model - whatever the cache still holds must carry the latest value
+        SplayCache<int, int> cache(64);
+        std::map<int, int> model;
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<int> key_dist(0, 255), op_dist(0, 9);
+        for (int i = 0; i < 20000; ++i)
+        {
+            int key = key_dist(rng);
+            int op = op_dist(rng);
+            if (op < 5)
+            {
+                int *value = cache.get(key);
+                assert(value == nullptr || *value == model.at(key));
+            }
+            else if (op < 9)
+            {
+                bool fresh = cache.get(key) == nullptr;
+                assert(cache.put(key, i) == fresh);
+                model[key] = i;
+                assert(*cache.get(key) == i);
+            }
+            else
+                cache.erase(key);
+            assert(cache.size() <= cache.capacity());
+        }
+        assert(cache.evictions() > 0);
+        std::size_t cached = 0;
+        for (int key = 0; key < 256; ++key)
+            if (int *value = cache.get(key))
+            {
+                assert(*value == model.at(key));
+                cached++;
+            }
+        assert(cached == cache.size());
+
+        // Filling past capacity evicts one entry per new key
+        SplayCache<int, std::string> small(4);
+        for (int i = 0; i < 10; ++i)
+            assert(small.put(i, std::to_string(i)));
+        assert(small.size() == 4 && small.evictions() == 6);
+        assert(small.get(9) && *small.get(9) == "9");
+        assert(small.erase(9) && small.size() == 3 && !small.get(9) && !small.erase(9));
+
+        // A few hot keys, touched between every cold insert, stay near the root and are never the deepest leaf
+        SplayCache<int, int> hot(256);
+        for (int i = 0; i < 100000; ++i)
+        {
+            for (int h = 0; h < 4; ++h)
+                if (hot.get(h) == nullptr)
+                    hot.put(h, h);
+            hot.put(1000 + i, i);
+        }
+        hot.reset_counts();
+        for (int h = 0; h < 4; ++h)
+            assert(hot.get(h) && *hot.get(h) == h);
+        assert(hot.hits() == 8 && hot.misses() == 0 && hot.hit_ratio() == 1);
+
+        // A sequential fill leaves the tree a single path, which every eviction walk would go all the way
+        // down - splaying the victim's parent keeps the walks amortised logarithmic
+        SplayCache<int, int> scan(4096);
+        for (int i = 0; i < 200000; ++i)
+            assert(scan.put(i, i));
+        assert(scan.size() == 4096 && scan.evictions() == 200000 - 4096);
+
+        using Counted = SplayTree<int, std::less<int>, NodePool<int>, TreeStats>;
+        Counted counted;
+        std::uint64_t paths[8];
+        for (int i = 0; i < 200000; ++i)
+        {
+            counted.add(i);
+            if (counted.size() > 4096)
+            {
+                for (std::uint64_t &path : paths)
+                    path = rng();
+                assert(counted.remove_leaf(paths));
+            }
+        }
+        // Nodes visited and rotations per put, against a path 4096 long without the splay
+        double work = static_cast<double>(counted.stats().visits + counted.stats().rotations) / 200000;
+        assert(work < 20 * std::bit_width(4096u));
+
+        cout << "test_splay_cache passed." << endl;
+    }
+
     static void test_performance_comparison()
     {
         cout << "\n--- Performance Comparison (SplayTree vs std::set) ---" << endl;
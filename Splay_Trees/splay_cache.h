@@ -0,0 +1,134 @@
+#ifndef __SPLAY_CACHE_H__
+#define __SPLAY_CACHE_H__
+
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <concepts>
+
+#include "splay_tree.h"
+
+// Fixed-capacity key-value cache on a splay tree - a popularity-adaptive index in front of a slower store
+// Splaying does the recency bookkeeping for free: every hit moves its key to the root and pushes the keys
+// it passes down, so depth tracks how long a key has gone without a hit. When the cache is full, put
+// evicts the deepest of EVICTION_SAMPLES leaves found by random root-to-leaf walks. Nothing is kept per
+// access beyond the splay itself (no list, no timestamps). The walks are as long as the tree is deep, and a
+// sequential fill makes it a single path, so the victim's parent is splayed afterwards: no walk went deeper
+// than the victim, so that splay's rotations pay for the walks, and an eviction is amortised O(log n) with
+// EVICTION_SAMPLES as the constant
+// Lookups build a probe entry from the key, so V has to be default constructible
+template <typename K, typename V, typename Compare = std::less<K>>
+requires std::default_initializable<V>
+class SplayCache
+{
+public:
+    static constexpr std::size_t EVICTION_SAMPLES = 8;
+
+    // Constructor
+    explicit SplayCache(std::size_t capacity) : max_entries(capacity > 0 ? capacity : 1) {}
+
+    // The cached value, or nullptr on a miss - valid until the key is evicted or erased
+    V *get(const K &key)
+    {
+        const Entry *entry = entries.lookup(Entry(key));
+        if (entry == nullptr)
+        {
+            miss_count++;
+            return nullptr;
+        }
+
+        hit_count++;
+        return &entry->value;
+    }
+
+    // Insert or overwrite - returns true if key was not cached before
+    bool put(const K &key, V value)
+    {
+        if (const Entry *entry = entries.lookup(Entry(key)))
+        {
+            entry->value = std::move(value);
+            return false;
+        }
+
+        if (entries.size() == max_entries)
+            evict();
+        entries.add(Entry(key, std::move(value)));
+        return true;
+    }
+
+    bool erase(const K &key)
+    {
+        return entries.remove(Entry(key));
+    }
+
+    void clear()
+    {
+        entries.clear();
+        reset_counts();
+    }
+
+    std::size_t size() const { return entries.size(); }
+    std::size_t capacity() const { return max_entries; }
+
+    // Access counts since construction or the last reset
+    std::uint64_t hits() const { return hit_count; }
+    std::uint64_t misses() const { return miss_count; }
+    std::uint64_t evictions() const { return eviction_count; }
+
+    double hit_ratio() const
+    {
+        std::uint64_t total = hit_count + miss_count;
+        return total ? static_cast<double>(hit_count) / total : 0;
+    }
+
+    void reset_counts() { hit_count = miss_count = eviction_count = 0; }
+
+private: // Members
+    // Ordered by key alone; the value rides along and can be overwritten in place
+    struct Entry
+    {
+        K key;
+        mutable V value;
+
+        Entry() = default;
+        explicit Entry(const K &key) : key(key), value() {}
+        Entry(const K &key, V value) : key(key), value(std::move(value)) {}
+    };
+
+    struct EntryLess
+    {
+        [[no_unique_address]] Compare less_than;
+
+        bool operator()(const Entry &a, const Entry &b) const { return less_than(a.key, b.key); }
+    };
+
+    SplayTree<Entry, EntryLess> entries;
+    std::size_t max_entries;
+    std::uint64_t hit_count = 0, miss_count = 0, eviction_count = 0;
+    std::uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+private: // Functions
+    void evict()
+    {
+        std::uint64_t paths[EVICTION_SAMPLES];
+        for (std::uint64_t &path : paths)
+            path = next_random();
+        entries.remove_leaf(paths);
+        eviction_count++;
+    }
+
+    // xorshift64 - the walks only need cheap, well-spread bits
+    std::uint64_t next_random()
+    {
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 7;
+        rng_state ^= rng_state << 17;
+        return rng_state;
+    }
+
+private:
+    friend class SplayTreeTester;
+};
+
+#endif
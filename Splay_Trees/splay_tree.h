@@ -2,10 +2,22 @@
 #define __SPLAY_TREE_H__
 
 #include <utility>
+#include <span>
+#include <algorithm>
 #include <functional>
 #include <stack>
 #include <cassert>
 #include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <bit>
+
+#include "../Common/node_pool.h"
+#include "../Common/compare.h"
+#include "../Common/memory_usage.h"
+#include "../Common/instrumentation.h"
+#include "../Common/prefetch.h"
 
 enum Direction
 {
@@ -13,15 +25,72 @@ enum Direction
     D_RIGHT
 };
 
-template <typename T, typename Compare = std::less<T>>
+// Splay engines - the template argument after the instrumentation policy
+// BottomUpSplay descends to the node and then rotates it back up through parent pointers
+// TopDownSplay (Sleator and Tarjan) restructures during the one descent, splitting the path into a left and
+// a right tree and joining them under the accessed node at the end - nodes carry no parent pointer
+struct BottomUpSplay {};
+struct TopDownSplay {};
+
+// Splay policies - the template argument after the engine, deciding which accesses restructure the tree
+// An access the policy skips is a plain read: it writes nothing, so a read-mostly tree keeps its cache
+// lines clean. Each is called with the depth of the accessed node and the number of keys
+// FullSplay splays every access (the classic tree)
+// SemiSplay (Sleator and Tarjan) only rotates the parent in the zig-zig case and carries on from there,
+// so the node climbs about half way and each access does about half the rotations - bottom-up only
+// DepthSplay splays only accesses deeper than C * log2(n), leaving a tree that is already good alone
+// CountingSplay splays every K-th access - a deterministic take on splaying with probability 1 / K
+struct FullSplay
+{
+    static constexpr bool SEMI = false;
+    bool operator()(std::size_t, std::size_t) { return true; }
+};
+
+struct SemiSplay
+{
+    static constexpr bool SEMI = true;
+    bool operator()(std::size_t, std::size_t) { return true; }
+};
+
+template <double C = 2.0>
+struct DepthSplay
+{
+    static constexpr bool SEMI = false;
+    bool operator()(std::size_t depth, std::size_t size) { return depth > C * std::bit_width(size); }
+};
+
+template <unsigned K = 8>
+struct CountingSplay
+{
+    static constexpr bool SEMI = false;
+    unsigned accesses = 0;
+
+    bool operator()(std::size_t, std::size_t)
+    {
+        if (++accesses < K)
+            return false;
+        accesses = 0;
+        return true;
+    }
+};
+
+template <typename T, typename Compare = std::less<T>, typename Alloc = NodePool<T>, typename Stats = NoStats, typename Engine = BottomUpSplay,
+          typename Policy = FullSplay>
 class SplayTree
 {
+    static constexpr bool TOP_DOWN = std::is_same_v<Engine, TopDownSplay>;
+    static_assert(!(TOP_DOWN && Policy::SEMI), "semi-splaying is defined bottom-up");
+
+    // The top-down engine restructures as it descends, so it only gets the single pass when every access splays
+    static constexpr bool SPLAY_ON_DESCENT = TOP_DOWN && std::is_same_v<Policy, FullSplay>;
+
 public:
     // Constructors
     SplayTree() : node(nullptr) {}
     SplayTree(const T &val)
     {
-        node = new TreeNode(val);
+        node = create_node(val);
+        count = 1;
     }
 
     // Destructor
@@ -31,20 +100,21 @@ public:
     }
 
     // Copy
-    SplayTree(const SplayTree &other)
+    SplayTree(const SplayTree &other) : alloc(NodeTraits::select_on_container_copy_construction(other.alloc))
     {
-        auto copy = [](auto copy, const TreeNode *root, TreeNode *parent) -> TreeNode *
+        auto copy = [this](auto copy, const TreeNode *root, TreeNode *parent) -> TreeNode *
         {
             if (root == nullptr)
                 return nullptr;
-            TreeNode *ret = new TreeNode;
-            ret->parent = parent;
+            TreeNode *ret = create_node();
+            set_parent(ret, parent);
             ret->val = root->val;
             ret->children[D_LEFT] = copy(copy, root->children[D_LEFT], ret);
             ret->children[D_RIGHT] = copy(copy, root->children[D_RIGHT], ret);
             return ret;
         };
         node = copy(copy, other.node, nullptr);
+        count = other.count;
         less_than = other.less_than;
     }
 
@@ -55,14 +125,19 @@ public:
 
         SplayTree new_tree(other);
         std::swap(node, new_tree.node);
+        std::swap(finger, new_tree.finger);
+        std::swap(count, new_tree.count);
         std::swap(less_than, new_tree.less_than);
+        std::swap(alloc, new_tree.alloc);
         return *this;
     }
 
     // Move
-    SplayTree(SplayTree &&other) noexcept : node(other.node), less_than(std::move(other.less_than))
+    SplayTree(SplayTree &&other) noexcept : node(other.node), finger(other.finger), count(other.count), less_than(std::move(other.less_than)), alloc(std::move(other.alloc))
     {
         other.node = nullptr;
+        other.finger = nullptr;
+        other.count = 0;
     }
 
     SplayTree &operator=(SplayTree &&other) noexcept
@@ -72,23 +147,77 @@ public:
 
         clear(node);
         node = other.node;
+        finger = std::exchange(other.finger, nullptr);
+        count = other.count;
         less_than = std::move(other.less_than);
+        alloc = std::move(other.alloc);
         other.node = nullptr;
+        other.count = 0;
         return *this;
     }
 
+    // Bulk load from a sorted, duplicate-free range in O(n) - starts out perfectly balanced
+    template <std::forward_iterator It>
+    static SplayTree from_sorted(It first, It last)
+    {
+        SplayTree tree;
+        auto build = [&](auto build, std::size_t n, TreeNode *parent) -> TreeNode *
+        {
+            if (n == 0)
+                return nullptr;
+
+            TreeNode *ret = tree.create_node();
+            set_parent(ret, parent);
+            ret->children[D_LEFT] = build(build, (n - 1) / 2, ret);
+            ret->val = *first;
+            ++first;
+            ret->children[D_RIGHT] = build(build, n - 1 - (n - 1) / 2, ret);
+            return ret;
+        };
+
+        tree.count = std::distance(first, last);
+        tree.node = build(build, tree.count, nullptr);
+        return tree;
+    }
+
     // Search
     bool find(const T &val)
     {
-        TreeNode *root = node;
-        for (; root && root->val != val; root = root->children[less_than(val, root->val) ? D_LEFT : D_RIGHT])
-            ;
+        return lookup(val) != nullptr;
+    }
 
-        if (root == nullptr)
-            return false;
+    // Search, returning where val is stored - nullptr if it is not in the tree
+    // Nodes never trade values, so the pointer stays valid until val itself is removed
+    const T *lookup(const T &val)
+    {
+        if constexpr (SPLAY_ON_DESCENT)
+            return node && splay(val) == 0 ? &node->val : nullptr;
+        else
+        {
+            TreeNode *root = node;
+            std::size_t depth = 0;
+            std::weak_ordering cmp = std::weak_ordering::equivalent;
+            for (; root && (cmp = compare(val, root)) != 0; root = cmp < 0 ? root->children[D_LEFT] : root->children[D_RIGHT], depth++)
+                ;
 
-        fix(root);
-        return true;
+            if (root == nullptr)
+                return nullptr;
+
+            access(val, root, depth);
+            return &root->val;
+        }
+    }
+
+    // Batched search - out[i] = find(keys[i]), FIND_BATCH_GROUP descents at a time in lockstep (run_lockstep)
+    // Unlike find it does not splay - a batch is read-only and leaves the shape of the tree alone
+    void find_batch(std::span<const T> keys, std::span<bool> out) const
+    {
+        run_lockstep(keys, out, static_cast<const TreeNode *>(node), [this](const T &val, const TreeNode *root, bool &found) -> const TreeNode *
+        {
+            std::weak_ordering cmp = compare(val, root);
+            found = cmp == 0;
+            return root->children[cmp < 0 ? D_LEFT : D_RIGHT];
+        });
     }
 
     // Insert
@@ -96,41 +225,130 @@ public:
     {
         if (node == nullptr)
         {
-            node = new TreeNode(val);
+            node = create_node(val);
+            count = 1;
             return true;
         }
 
-        TreeNode *root = node, *root_par = nullptr;
-        for (; root && root->val != val; root_par = root, root = root->children[less_than(val, root->val) ? D_LEFT : D_RIGHT])
-            ;
+        // The closest key ends up at the root, and val goes in above it
+        if constexpr (SPLAY_ON_DESCENT)
+        {
+            std::weak_ordering cmp = splay(val);
+            if (cmp == 0)
+                return false;
+
+            Direction dir = cmp < 0 ? D_LEFT : D_RIGHT;
+            TreeNode *ins_node = create_node(val);
+            ins_node->children[dir] = node->children[dir];
+            ins_node->children[!dir] = node;
+            node->children[dir] = nullptr;
+            node = ins_node;
+            count++;
+            return true;
+        }
+        else
+        {
+            TreeNode *root = node, *root_par = nullptr;
+            std::size_t depth = 0;
+            std::weak_ordering cmp = std::weak_ordering::equivalent;
+            for (; root && (cmp = compare(val, root)) != 0; root_par = root, root = cmp < 0 ? root->children[D_LEFT] : root->children[D_RIGHT], depth++)
+                ;
 
-        if (root != nullptr)
-            return false;
+            if (root != nullptr)
+                return false;
 
-        TreeNode *ins_node = new TreeNode(val);
-        root_par->children[less_than(val, root_par->val) ? D_LEFT : D_RIGHT] = ins_node;
-        ins_node->parent = root_par;
-        fix(ins_node);
-        return true;
+            TreeNode *ins_node = create_node(val);
+            root_par->children[cmp < 0 ? D_LEFT : D_RIGHT] = ins_node;
+            set_parent(ins_node, root_par);
+            count++;
+            access(val, ins_node, depth);
+            return true;
+        }
+    }
+
+    // Finger search - find and add starting from the node the previous find_near / add_near reached rather
+    // than from the root. The walk climbs parent pointers until val is inside the subtree and descends from
+    // there, so a key d positions away from the previous one costs O(log d) amortised, not the full height
+    // With full splaying the finger is the root anyway; the saving is with the policies that leave accessed
+    // nodes where they are. The top-down engine has no parent pointers to climb - there these are find and add
+    bool find_near(const T &val)
+    {
+        if constexpr (TOP_DOWN)
+            return find(val);
+        else
+        {
+            if (node == nullptr)
+                return false;
+
+            std::size_t depth = 0;
+            TreeNode *last = nullptr;
+            std::weak_ordering cmp = std::weak_ordering::equivalent;
+            TreeNode *found = descend(climb(val, depth), val, last, cmp, depth);
+            finger = found ? found : last;
+            if (found)
+                access(val, found, depth);
+            return found != nullptr;
+        }
+    }
+
+    bool add_near(const T &val)
+    {
+        if constexpr (TOP_DOWN)
+            return add(val);
+        else
+        {
+            if (node == nullptr)
+            {
+                add(val);
+                finger = node;
+                return true;
+            }
+
+            std::size_t depth = 0;
+            TreeNode *last = nullptr;
+            std::weak_ordering cmp = std::weak_ordering::equivalent;
+            if (TreeNode *found = descend(climb(val, depth), val, last, cmp, depth))
+            {
+                finger = found;
+                return false;
+            }
+
+            TreeNode *ins_node = create_node(val);
+            last->children[cmp < 0 ? D_LEFT : D_RIGHT] = ins_node;
+            set_parent(ins_node, last);
+            count++;
+            finger = ins_node;
+            access(val, ins_node, depth);
+            return true;
+        }
     }
 
     // Delete
     bool remove(const T &val)
     {
-        if (!find(val))
+        if (!splay_to_root(val))
             return false;
 
-        assert(node->val == val);
+        assert(three_way(less_than, node->val, val) == 0);
+        if (finger == node)
+            finger = nullptr;
         TreeNode *left = node->children[D_LEFT], *right = node->children[D_RIGHT];
         node->children[D_LEFT] = node->children[D_RIGHT] = nullptr;
-        delete node;
+        destroy_node(node);
         node = nullptr;
 
         if (left == nullptr)
         {
             node = right;
             if (node)
-                node->parent = nullptr;
+                set_parent(node, nullptr);
+        }
+        else if constexpr (TOP_DOWN)
+        {
+            // val is above every key on the left, so splaying it there lifts the maximum, which has no right child
+            node = left;
+            splay(val);
+            node->children[D_RIGHT] = right;
         }
         else
         {
@@ -149,29 +367,135 @@ public:
             node = in_ord_suc;
         }
 
+        count--;
         return true;
     }
 
+    // Removes the deepest of the leaves reached by walking down from the root once per path - at each level
+    // the next bit of the path picks the child, or the only child is taken. False if the tree is empty
+    // The victim's parent is then splayed to the root, whatever the policy: no walk went deeper than the
+    // victim, so that splay pays for all of them, and a run of evictions down a long path (a sequential
+    // fill) shortens it instead of walking it again each time
+    bool remove_leaf(std::span<const std::uint64_t> paths)
+    {
+        if (node == nullptr)
+            return false;
+
+        TreeNode *victim = nullptr, *victim_par = nullptr;
+        std::size_t victim_depth = 0;
+        for (std::uint64_t path : paths)
+        {
+            TreeNode *leaf = node, *leaf_par = nullptr;
+            std::size_t depth = 0;
+            for (; leaf->children[D_LEFT] || leaf->children[D_RIGHT]; path = std::rotr(path, 1), depth++)
+            {
+                counters.visit();
+                leaf_par = leaf;
+                Direction side = path & 1 ? D_RIGHT : D_LEFT;
+                leaf = leaf->children[side] ? leaf->children[side] : leaf->children[!side];
+            }
+
+            if (victim == nullptr || depth > victim_depth)
+            {
+                victim = leaf;
+                victim_par = leaf_par;
+                victim_depth = depth;
+            }
+        }
+
+        if (victim == nullptr)
+            return false;
+        if (victim_par == nullptr)
+            node = nullptr;
+        else
+            victim_par->children[victim_par->children[D_LEFT] == victim ? D_LEFT : D_RIGHT] = nullptr;
+        if (finger == victim)
+            finger = nullptr;
+
+        destroy_node(victim);
+        count--;
+
+        if (victim_par)
+        {
+            if constexpr (TOP_DOWN)
+                splay(victim_par->val);
+            else
+                fix(victim_par);
+        }
+        return true;
+    }
+
+    std::size_t size() const { return count; }
+
     void clear()
     {
         clear(node);
         node = nullptr;
+        finger = nullptr;
+        count = 0;
+    }
+
+    // Node counts and bytes held by nodes - one key per node, so fill is always 1
+    MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage;
+        if constexpr (reserving_allocator<NodeAlloc>)
+            usage.reserved = alloc.reserved();
+        if (node == nullptr)
+            return usage;
+
+        std::stack<const TreeNode *> st;
+        st.push(node);
+
+        while (!st.empty())
+        {
+            const TreeNode *top = st.top();
+            st.pop();
+
+            usage.nodes++;
+            if (top->children[D_LEFT])
+                st.push(top->children[D_LEFT]);
+            if (top->children[D_RIGHT])
+                st.push(top->children[D_RIGHT]);
+            if (top->children[D_LEFT] || top->children[D_RIGHT])
+                usage.internals++;
+            else
+                usage.leaves++;
+        }
+
+        usage.keys = usage.nodes;
+        usage.bytes = usage.nodes * sizeof(TreeNode);
+        usage.fill = 1;
+        return usage;
     }
 
+    // Instrumentation counters - all zero-cost no-ops unless the tree was instantiated with a counting policy
+    const Stats &stats() const { return counters; }
+    void reset_stats() { counters.reset(); }
+
 private: // Members
-    struct TreeNode
+    struct TreeNode;
+
+    struct ParentLink
+    {
+        TreeNode *parent = nullptr;
+    };
+
+    struct NoParentLink {};
+
+    // The top-down engine never walks back up, so its nodes are a pointer smaller
+    struct TreeNode : std::conditional_t<TOP_DOWN, NoParentLink, ParentLink>
     {
         T val;
         TreeNode *children[2];
-        TreeNode *parent;
 
-        TreeNode() : val(), parent(nullptr)
+        TreeNode() : val()
         {
             children[D_LEFT] = nullptr;
             children[D_RIGHT] = nullptr;
         }
 
-        TreeNode(const T &val) : val(val), parent(nullptr)
+        TreeNode(const T &val) : val(val)
         {
             children[D_LEFT] = nullptr;
             children[D_RIGHT] = nullptr;
@@ -179,14 +503,128 @@ private: // Members
     };
 
     TreeNode *node;
+    TreeNode *finger = nullptr; // Where find_near / add_near start - cleared when its node is removed
+    std::size_t count = 0;
     Compare less_than;
+    [[no_unique_address]] Policy policy;
+
+    using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<TreeNode>;
+    using NodeTraits = std::allocator_traits<NodeAlloc>;
+    NodeAlloc alloc;
+    [[no_unique_address]] mutable Stats counters;
 
 private: // Functions
+    // Compares val against a node on the way down - where visits and comparisons are counted
+    std::weak_ordering compare(const T &val, const TreeNode *n) const
+    {
+        counters.visit();
+        counters.comparison();
+        return three_way(less_than, val, n->val);
+    }
+
+    static void set_parent(TreeNode *n, TreeNode *parent)
+    {
+        if constexpr (!TOP_DOWN)
+            n->parent = parent;
+    }
+
+    // An access to n, depth levels down - restructures only if the policy asks for it
+    void access(const T &val, TreeNode *n, std::size_t depth)
+    {
+        if (!policy(depth, count))
+            return;
+
+        if constexpr (TOP_DOWN)
+            splay(val);
+        else if constexpr (Policy::SEMI)
+            semi_fix(n, depth);
+        else
+            fix(n);
+    }
+
+    // Plain descent from start - the node holding val, or nullptr with last the node val would hang from
+    // and cmp the side; depth counts the levels walked
+    TreeNode *descend(TreeNode *start, const T &val, TreeNode *&last, std::weak_ordering &cmp, std::size_t &depth)
+    {
+        cmp = std::weak_ordering::equivalent;
+        TreeNode *root = start;
+        for (; root && (cmp = compare(val, root)) != 0; last = root, root = cmp < 0 ? root->children[D_LEFT] : root->children[D_RIGHT], depth++)
+            ;
+        return root;
+    }
+
+    // Climbs from the finger to the lowest node whose subtree holds every key between the finger's and val
+    // An ancestor on the far side of val bounds nothing and is passed; the first one beyond val stops the climb
+    TreeNode *climb(const T &val, std::size_t &depth)
+    {
+        TreeNode *cur = finger ? finger : node;
+        std::weak_ordering cmp = compare(val, cur);
+        if (cmp == 0)
+            return cur;
+
+        Direction side = cmp < 0 ? D_LEFT : D_RIGHT;
+        for (TreeNode *p = cur->parent; p; cur = p, p = p->parent)
+        {
+            depth++;
+            if (p->children[side] == cur)
+                continue;
+
+            std::weak_ordering p_cmp = compare(val, p);
+            if (p_cmp == 0)
+                return p;
+            if ((p_cmp < 0) != (side == D_LEFT))
+                break;
+        }
+
+        return cur;
+    }
+
+    // Brings val to the root whatever the policy, as remove needs - false if it is not in the tree
+    bool splay_to_root(const T &val)
+    {
+        if constexpr (TOP_DOWN)
+            return node && splay(val) == 0;
+        else
+        {
+            TreeNode *root = node;
+            std::weak_ordering cmp = std::weak_ordering::equivalent;
+            for (; root && (cmp = compare(val, root)) != 0; root = cmp < 0 ? root->children[D_LEFT] : root->children[D_RIGHT])
+                ;
+
+            if (root == nullptr)
+                return false;
+
+            fix(root);
+            return true;
+        }
+    }
+
+    template <typename... Args>
+    TreeNode *create_node(Args &&...args)
+    {
+        TreeNode *ret = NodeTraits::allocate(alloc, 1);
+        NodeTraits::construct(alloc, ret, std::forward<Args>(args)...);
+        return ret;
+    }
+
+    void destroy_node(TreeNode *node)
+    {
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
+    }
+
     void clear(TreeNode *node)
     {
         if (node == nullptr)
             return;
 
+        // Pooled nodes with nothing to destruct are dropped a slab at a time - no traversal
+        if constexpr (releasable_allocator<NodeAlloc> && std::is_trivially_destructible_v<TreeNode>)
+        {
+            alloc.release();
+            return;
+        }
+
         std::stack<TreeNode *> st;
         st.push(node);
 
@@ -210,7 +648,7 @@ private: // Functions
 
             else
             {
-                delete top;
+                destroy_node(top);
                 st.pop();
             }
         }
@@ -218,6 +656,7 @@ private: // Functions
 
     void left_rotate(TreeNode *gp, TreeNode *p, TreeNode *n)
     {
+        counters.rotation();
         if (gp == nullptr) // Parent is root
         {
             node = n;
@@ -238,6 +677,7 @@ private: // Functions
 
     void right_rotate(TreeNode *gp, TreeNode *p, TreeNode *n)
     {
+        counters.rotation();
         if (gp == nullptr) // Parent is root
         {
             node = n;
@@ -258,6 +698,8 @@ private: // Functions
 
     void fix(TreeNode *root)
     {
+        // Every rotation lifts root one level, so the rotations made are the depth it started at
+        std::size_t depth = 0;
         while (root != node)
         {
             TreeNode *p = root->parent;
@@ -268,10 +710,13 @@ private: // Functions
                     right_rotate(gp, p, root);
                 else
                     left_rotate(gp, p, root);
+                depth++;
             }
 
             else
             {
+                depth += 2;
+
                 // Left
                 if (gp->children[D_LEFT] == p)
                 {
@@ -309,6 +754,120 @@ private: // Functions
                 }
             }
         }
+
+        counters.splay(depth);
+    }
+
+    // Semi-splay - a zig-zig rotates only the parent and continues from it, a zig-zag is a full double
+    // rotation; root ends up roughly half way between where it was and the top
+    void semi_fix(TreeNode *root, std::size_t depth)
+    {
+        while (root != node)
+        {
+            TreeNode *p = root->parent;
+            TreeNode *gp = p->parent;
+            if (gp == nullptr)
+            {
+                if (p->children[D_LEFT] == root)
+                    right_rotate(gp, p, root);
+                else
+                    left_rotate(gp, p, root);
+                break;
+            }
+
+            bool p_left = gp->children[D_LEFT] == p, root_left = p->children[D_LEFT] == root;
+
+            // Zig-zig
+            if (p_left == root_left)
+            {
+                if (p_left)
+                    right_rotate(gp->parent, gp, p);
+                else
+                    left_rotate(gp->parent, gp, p);
+                root = p;
+            }
+
+            // Zig-zag
+            else if (p_left)
+            {
+                left_rotate(gp, p, root);
+                right_rotate(gp->parent, gp, root);
+            }
+            else
+            {
+                right_rotate(gp, p, root);
+                left_rotate(gp->parent, gp, root);
+            }
+        }
+
+        counters.splay(depth);
+    }
+
+    // Top-down splay - brings the node holding val, or else the last node on its search path, to the root
+    // and returns how val compares with it
+    // Nodes passed on the way down are hung off two side trees: everything known to be smaller than val
+    // goes to the right spine of the left tree, everything larger to the left spine of the right tree.
+    // Two steps in the same direction (zig-zig) rotate first, which is what keeps the amortised bound;
+    // a zig-zag is just two plain links
+    std::weak_ordering splay(const T &val)
+    {
+        TreeNode *left_tree = nullptr, *right_tree = nullptr;
+        TreeNode **left_hook = &left_tree, **right_hook = &right_tree;
+        TreeNode *root = node;
+        std::size_t depth = 0;
+
+        std::weak_ordering cmp = compare(val, root);
+        while (cmp != 0)
+        {
+            Direction dir = cmp < 0 ? D_LEFT : D_RIGHT;
+            TreeNode *child = root->children[dir];
+            if (child == nullptr)
+                break;
+
+            std::weak_ordering child_cmp = compare(val, child);
+            depth++;
+
+            // Zig-zig - rotate child above root before linking
+            if (child_cmp != 0 && (child_cmp < 0) == (cmp < 0))
+            {
+                counters.rotation();
+                root->children[dir] = child->children[!dir];
+                child->children[!dir] = root;
+                root = child;
+                cmp = child_cmp;
+
+                child = root->children[dir];
+                if (child == nullptr)
+                    break;
+                child_cmp = compare(val, child);
+                depth++;
+            }
+
+            // Link - root and its far subtree all lie on one side of val
+            if (dir == D_LEFT)
+            {
+                *right_hook = root;
+                right_hook = &root->children[D_LEFT];
+            }
+            else
+            {
+                *left_hook = root;
+                left_hook = &root->children[D_RIGHT];
+            }
+
+            root = child;
+            cmp = child_cmp;
+        }
+
+        // Assemble - root's subtrees go to the inner ends of the side trees, which become its children
+        *left_hook = root->children[D_LEFT];
+        *right_hook = root->children[D_RIGHT];
+        root->children[D_LEFT] = left_tree;
+        root->children[D_RIGHT] = right_tree;
+        node = root;
+
+        counters.splay(depth);
+        return cmp;
     }
 
 private:
@@ -8,16 +8,60 @@
 #include <iomanip>
 #include <functional>
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <string_view>
+#include <span>
+#include <cstdint>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
 
 // --- C++ Tree Headers ---
+#include "Common/memory_usage.h"
+#include "Common/counting_allocator.h"
+#include "Common/instrumentation.h"
 #include "B_Trees/btree.h"
+#include "B_Trees/bplustree.h"
+#include "B_Trees/concurrent_btree.h"
+#include "RB_Trees/concurrent_rbtree.h"
 #include "RB_Trees/rbtree.h"
 #include "Splay_Trees/splay_tree.h"
+#include "Splay_Trees/splay_cache.h"
 #include "AVL_Trees/avl_tree.h"
 
+// --- Benchmark Support ---
+#include "Benchmark/workload.h"
+#include "Benchmark/report.h"
+#include "Benchmark/lru_cache.h"
+
 // --- Configuration ---
-const int NUM_ELEMENTS = 100'000;
-const int B_TREE_ORDER = 16; // A reasonable order for in-memory B-Trees
+const int DEFAULT_ELEMENTS = 100'000; // Element count when --sizes is not given
+const int B_TREE_ORDER = 16;         // A reasonable order for in-memory B-Trees
+
+// B-Tree orders compiled into the --sweep mode; --orders picks a subset at run time
+using SweepOrders = std::index_sequence<4, 8, 16, 32, 64, 128, 256>;
+
+// Every value the tables print is also recorded here for --csv / --json
+BenchmarkReport report;
 
 // =================================================================================================
 // 1. UNIFIED INTERFACE & WRAPPERS
@@ -35,6 +79,8 @@ public:
     virtual bool find(int value) = 0;
     virtual bool remove(int value) = 0;
     virtual void clear() = 0;
+    virtual MemoryUsage memory_usage() const = 0;
+    virtual void find_batch(std::span<const int> keys, std::span<bool> out) = 0;
 };
 
 /**
@@ -66,6 +112,8 @@ public:
     bool add(int value) override { return tree.add(value); }
     bool find(int value) override { return tree.find(value); }
     bool remove(int value) override { return tree.remove(value); }
+    MemoryUsage memory_usage() const override { return tree.memory_usage(); }
+    void find_batch(std::span<const int> keys, std::span<bool> out) override { tree.find_batch(keys, out); }
 
     void clear() override
     {
@@ -81,24 +129,329 @@ public:
     }
 };
 
+/**
+ * @brief Orders ints exactly like std::less<int>, but as a distinct type it keeps BTree on its scalar
+ * binary search instead of the vectorised rank kernel - lets the benchmark compare the two.
+ */
+struct ScalarLess
+{
+    bool operator()(int a, int b) const { return a < b; }
+};
+
+// Plain bool comparator over strings - the trees cannot see an ordering and fall back to two calls per node
+struct StringLess
+{
+    bool operator()(const std::string &a, const std::string &b) const { return a < b; }
+};
+
 // =================================================================================================
 // 2. BENCHMARKING FRAMEWORK
 // =================================================================================================
 
+/**
+ * @brief Hardware event totals for one benchmark phase, scaled up if the kernel had to multiplex the group.
+ * An event that could not be opened on this machine reads as a negative value.
+ */
+struct PhaseCounters
+{
+    enum Event
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        DTLB_MISSES,
+        EVENT_COUNT
+    };
+
+    std::array<double, EVENT_COUNT> values;
+    bool measured = false;
+
+    PhaseCounters() { values.fill(-1); }
+};
+
+/**
+ * @brief One `perf_event_open` counter group (user space only) for the calling thread, read around each phase.
+ * Events the CPU or hypervisor does not expose are skipped individually; if none open - no PMU, or
+ * perf_event_paranoid forbids it - `available()` is false and `error()` says why, and the benchmark runs
+ * without counters.
+ */
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        fds.fill(-1);
+#if defined(__linux__)
+        constexpr auto cache_miss = [](std::uint64_t cache, std::uint64_t op)
+        { return cache | (op << 8) | (static_cast<std::uint64_t>(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16); };
+        const std::pair<std::uint32_t, std::uint64_t> events[PhaseCounters::EVENT_COUNT] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ)},
+        };
+
+        int first_errno = 0;
+        for (int e = 0; e < PhaseCounters::EVENT_COUNT; ++e)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[e].first;
+            attr.config = events[e].second;
+            attr.disabled = leader < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            fds[e] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fds[e] < 0)
+                first_errno = first_errno ? first_errno : errno;
+            else if (leader < 0)
+                leader = fds[e];
+        }
+
+        if (leader < 0)
+        {
+            reason = std::string("perf_event_open failed: ") + std::strerror(first_errno);
+            if (first_errno == EACCES || first_errno == EPERM)
+                reason += " - lower /proc/sys/kernel/perf_event_paranoid or grant CAP_PERFMON";
+            else if (first_errno == ENOENT || first_errno == EOPNOTSUPP)
+                reason += " - no hardware PMU is exposed, as is common inside VMs and containers";
+        }
+#else
+        reason = "perf_event_open is only available on Linux";
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const { return leader >= 0; }
+    const std::string &error() const { return reason; }
+
+    void start()
+    {
+#if defined(__linux__)
+        if (leader < 0)
+            return;
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    PhaseCounters stop()
+    {
+        PhaseCounters counters;
+#if defined(__linux__)
+        if (leader < 0)
+            return counters;
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // Group read layout: nr, time_enabled, time_running, then one value per open event in creation order
+        std::uint64_t data[3 + PhaseCounters::EVENT_COUNT];
+        if (read(leader, data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || data[2] == 0)
+            return counters;
+
+        double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        std::size_t slot = 0;
+        for (int e = 0; e < PhaseCounters::EVENT_COUNT && slot < data[0]; ++e)
+            if (fds[e] >= 0)
+                counters.values[e] = static_cast<double>(data[3 + slot++]) * scale;
+        counters.measured = true;
+#endif
+        return counters;
+    }
+
+private:
+    std::array<int, PhaseCounters::EVENT_COUNT> fds;
+    int leader = -1;
+    std::string reason;
+};
+
 struct BenchmarkResults
 {
     std::chrono::duration<double, std::milli> insert_time;
     std::chrono::duration<double, std::milli> find_hit_time;
     std::chrono::duration<double, std::milli> find_miss_time;
     std::chrono::duration<double, std::milli> remove_time;
+
+    PhaseCounters insert_counters;
+    PhaseCounters find_hit_counters;
+    PhaseCounters find_miss_counters;
+    PhaseCounters remove_counters;
+
+    MemoryUsage memory; // Taken once every key is in, outside the timed phases
+};
+
+/**
+ * @brief Per-operation timestamps. Reads the TSC on x86 (a handful of cycles, no syscall) and falls back
+ * to steady_clock elsewhere; `ns_per_tick()` converts, calibrated once against steady_clock.
+ * `stop()` uses RDTSCP, which waits for the timed instructions to finish before reading the counter.
+ */
+struct Ticks
+{
+    static std::uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static std::uint64_t stop()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int aux;
+        return __rdtscp(&aux);
+#else
+        return now();
+#endif
+    }
+
+    static double ns_per_tick()
+    {
+        static const double ratio = []
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            auto wall_start = std::chrono::steady_clock::now();
+            std::uint64_t tick_start = now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::chrono::duration<double, std::nano> wall = std::chrono::steady_clock::now() - wall_start;
+            return wall.count() / static_cast<double>(now() - tick_start);
+#else
+            return 1.0;
+#endif
+        }();
+        return ratio;
+    }
+};
+
+/**
+ * @brief HDR-style log-linear histogram of tick counts. Values below 2^SUB_BITS get a bucket each; above
+ * that every power of two is cut into 2^SUB_BITS linear buckets, so any percentile is within ~3% of the
+ * true value while recording stays a bit scan and an increment into a fixed 16 KiB array.
+ */
+class LatencyHistogram
+{
+public:
+    void record(std::uint64_t value)
+    {
+        ++buckets[index(value)];
+        ++total;
+        max_value = std::max(max_value, value);
+    }
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t max() const { return max_value; }
+
+    // Highest value in the bucket holding the p-th percentile sample (p in [0, 100])
+    std::uint64_t percentile(double p) const
+    {
+        if (total == 0)
+            return 0;
+
+        std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p / 100.0 * total)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::min(highest_in_bucket(i), max_value);
+        }
+
+        return max_value;
+    }
+
+private:
+    static constexpr int SUB_BITS = 5;
+    static constexpr std::uint64_t SUB_COUNT = 1ull << SUB_BITS;
+
+    std::array<std::uint64_t, (64 - SUB_BITS + 1) * SUB_COUNT> buckets{};
+    std::uint64_t total = 0;
+    std::uint64_t max_value = 0;
+
+    static std::size_t index(std::uint64_t value)
+    {
+        if (value < SUB_COUNT)
+            return value;
+
+        int shift = std::bit_width(value) - 1 - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((value >> shift) - SUB_COUNT);
+    }
+
+    static std::uint64_t highest_in_bucket(std::size_t idx)
+    {
+        if (idx < SUB_COUNT)
+            return idx;
+
+        int shift = static_cast<int>(idx >> SUB_BITS) - 1;
+        std::uint64_t lowest = ((idx & (SUB_COUNT - 1)) + SUB_COUNT) << shift;
+        return lowest + ((1ull << shift) - 1);
+    }
+};
+
+struct LatencyResults
+{
+    LatencyHistogram insert;
+    LatencyHistogram find_hit;
+    LatencyHistogram find_miss;
+    LatencyHistogram remove;
 };
 
-void run_benchmark(IBenchmarkableTree &tree, const std::vector<int> &insert_data, const std::vector<int> &search_miss_data, BenchmarkResults &results)
+/**
+ * @brief Same four phases as `run_benchmark`, but every operation is timed on its own and sampled into a
+ * histogram. Kept as a separate pass so the timestamp reads do not distort the throughput table.
+ * Returns the number of successful operations so none of the calls can be discarded.
+ */
+template <typename Add, typename Find, typename Remove>
+std::size_t run_latency_benchmark(Add add, Find find, Remove remove, const std::vector<int> &insert_data,
+                                  const std::vector<int> &search_miss_data, LatencyResults &results)
+{
+    // The volatile store pins each call between its two timestamps - otherwise an inlined, side-effect
+    // free find (std::set) may be moved past the closing read or dropped
+    std::size_t successes = 0;
+    volatile bool result;
+    auto sample = [&](LatencyHistogram &histogram, const std::vector<int> &data, auto &op)
+    {
+        for (int val : data)
+        {
+            std::uint64_t start = Ticks::now();
+            result = op(val);
+            histogram.record(Ticks::stop() - start);
+            successes += result;
+        }
+    };
+
+    sample(results.insert, insert_data, add);
+    sample(results.find_hit, insert_data, find);
+    sample(results.find_miss, search_miss_data, find);
+    sample(results.remove, insert_data, remove);
+    return successes;
+}
+
+void run_benchmark(IBenchmarkableTree &tree, const std::vector<int> &insert_data, const std::vector<int> &search_miss_data, BenchmarkResults &results,
+                   PerfCounters *perf = nullptr)
 {
 
     tree.clear();
 
     // 1. Benchmark Insertion
+    if (perf)
+        perf->start();
     auto start = std::chrono::high_resolution_clock::now();
     for (int val : insert_data)
     {
@@ -106,8 +459,13 @@ void run_benchmark(IBenchmarkableTree &tree, const std::vector<int> &insert_data
     }
     auto end = std::chrono::high_resolution_clock::now();
     results.insert_time = end - start;
+    if (perf)
+        results.insert_counters = perf->stop();
+    results.memory = tree.memory_usage();
 
     // 2. Benchmark Successful Search (Find Hit)
+    if (perf)
+        perf->start();
     start = std::chrono::high_resolution_clock::now();
     for (int val : insert_data)
     {
@@ -115,8 +473,12 @@ void run_benchmark(IBenchmarkableTree &tree, const std::vector<int> &insert_data
     }
     end = std::chrono::high_resolution_clock::now();
     results.find_hit_time = end - start;
+    if (perf)
+        results.find_hit_counters = perf->stop();
 
     // 3. Benchmark Unsuccessful Search (Find Miss)
+    if (perf)
+        perf->start();
     start = std::chrono::high_resolution_clock::now();
     for (int val : search_miss_data)
     {
@@ -124,8 +486,12 @@ void run_benchmark(IBenchmarkableTree &tree, const std::vector<int> &insert_data
     }
     end = std::chrono::high_resolution_clock::now();
     results.find_miss_time = end - start;
+    if (perf)
+        results.find_miss_counters = perf->stop();
 
     // 4. Benchmark Deletion
+    if (perf)
+        perf->start();
     start = std::chrono::high_resolution_clock::now();
     for (int val : insert_data)
     {
@@ -133,14 +499,21 @@ void run_benchmark(IBenchmarkableTree &tree, const std::vector<int> &insert_data
     }
     end = std::chrono::high_resolution_clock::now();
     results.remove_time = end - start;
+    if (perf)
+        results.remove_counters = perf->stop();
 }
 
 
-void run_benchmark(const std::vector<int> &insert_data, const std::vector<int> &search_miss_data, BenchmarkResults &results)
+void run_benchmark(const std::vector<int> &insert_data, const std::vector<int> &search_miss_data, BenchmarkResults &results,
+                   PerfCounters *perf = nullptr)
 {
-    std::set<int> tree;
+    // std::set has no node walk to offer, so its nodes are counted as they are allocated
+    AllocationCounter counter;
+    std::set<int, std::less<int>, CountingAllocator<int>> tree{CountingAllocator<int>(counter)};
 
     // 1. Benchmark Insertion
+    if (perf)
+        perf->start();
     auto start = std::chrono::high_resolution_clock::now();
     for (int val : insert_data)
     {
@@ -148,8 +521,15 @@ void run_benchmark(const std::vector<int> &insert_data, const std::vector<int> &
     }
     auto end = std::chrono::high_resolution_clock::now();
     results.insert_time = end - start;
+    if (perf)
+        results.insert_counters = perf->stop();
+    results.memory.keys = results.memory.nodes = tree.size();
+    results.memory.bytes = counter.live_bytes;
+    results.memory.fill = 1;
 
     // 2. Benchmark Successful Search (Find Hit)
+    if (perf)
+        perf->start();
     start = std::chrono::high_resolution_clock::now();
     for (int val : insert_data)
     {
@@ -157,8 +537,12 @@ void run_benchmark(const std::vector<int> &insert_data, const std::vector<int> &
     }
     end = std::chrono::high_resolution_clock::now();
     results.find_hit_time = end - start;
+    if (perf)
+        results.find_hit_counters = perf->stop();
 
     // 3. Benchmark Unsuccessful Search (Find Miss)
+    if (perf)
+        perf->start();
     start = std::chrono::high_resolution_clock::now();
     for (int val : search_miss_data)
     {
@@ -166,8 +550,12 @@ void run_benchmark(const std::vector<int> &insert_data, const std::vector<int> &
     }
     end = std::chrono::high_resolution_clock::now();
     results.find_miss_time = end - start;
+    if (perf)
+        results.find_miss_counters = perf->stop();
 
     // 4. Benchmark Deletion
+    if (perf)
+        perf->start();
     start = std::chrono::high_resolution_clock::now();
     for (int val : insert_data)
     {
@@ -175,74 +563,1566 @@ void run_benchmark(const std::vector<int> &insert_data, const std::vector<int> &
     }
     end = std::chrono::high_resolution_clock::now();
     results.remove_time = end - start;
+    if (perf)
+        results.remove_counters = perf->stop();
 }
 
 
-void print_results(const std::string &tree_name, const BenchmarkResults &results)
+/**
+ * @brief Lookup throughput of one `find` per key against `find_batch` over batches of `batch` keys, on trees
+ * holding insert_data and queried with the same keys in another order - every lookup hits. The lockstep
+ * descents only pay off once the tree no longer fits in cache, so run it with `--sizes=1e6` or more.
+ */
+void run_batch_benchmark(const std::vector<std::unique_ptr<IBenchmarkableTree>> &trees, const std::vector<int> &insert_data,
+                         std::size_t batch = 256)
 {
-    std::cout << "| " << std::left << std::setw(15) << tree_name
-              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.insert_time.count() << " ms "
-              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.find_hit_time.count() << " ms "
-              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.find_miss_time.count() << " ms "
-              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.remove_time.count() << " ms |"
-              << std::endl;
+    std::vector<int> queries = insert_data;
+    std::shuffle(queries.begin(), queries.end(), std::mt19937(99));
+    std::unique_ptr<bool[]> out(new bool[batch]);
+
+    const std::string header = "| Tree Type       |  find Mops/s | batch Mops/s | Speed-up |";
+    std::cout << "\n--- Batched Lookups (" << insert_data.size() << " elements, batches of " << batch << ") ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    for (const auto &tree : trees)
+    {
+        tree->clear();
+        for (int val : insert_data)
+            tree->add(val);
+
+        std::size_t single_hits = 0, batch_hits = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int val : queries)
+            single_hits += tree->find(val);
+        std::chrono::duration<double> single = std::chrono::high_resolution_clock::now() - start;
+
+        start = std::chrono::high_resolution_clock::now();
+        for (std::size_t base = 0; base < queries.size(); base += batch)
+        {
+            std::size_t n = std::min(batch, queries.size() - base);
+            tree->find_batch(std::span<const int>(queries).subspan(base, n), std::span<bool>(out.get(), n));
+            batch_hits += std::count(out.get(), out.get() + n, true);
+        }
+        std::chrono::duration<double> batched = std::chrono::high_resolution_clock::now() - start;
+
+        if (single_hits != batch_hits)
+            std::cout << "find_batch disagrees with find on " << tree->name() << "\n";
+
+        double single_rate = queries.size() / single.count() / 1e6, batch_rate = queries.size() / batched.count() / 1e6;
+        std::cout << "| " << std::left << std::setw(16) << tree->name() << std::right << std::fixed << std::setprecision(2)
+                  << "| " << std::setw(12) << single_rate << " | " << std::setw(12) << batch_rate << " | " << std::setw(7)
+                  << batch_rate / single_rate << "x |\n";
+        report.add("batch", tree->name(), "find", "Mops/s", single_rate);
+        report.add("batch", tree->name(), "find_batch", "Mops/s", batch_rate);
+        report.add("batch", tree->name(), "speedup", "x", batch_rate / single_rate);
+        tree->clear();
+    }
+    std::cout << std::string(header.size(), '-') << "\n";
 }
 
-// =================================================================================================
-// 3. MAIN EXECUTION
-// =================================================================================================
+/**
+ * @brief Plain `find`, lockstep `find_batch` and coroutine `find_interleaved` on one tree, over the same
+ * shuffled hits as `run_batch_benchmark`. Rows are added to the table the caller printed the header of.
+ */
+template <typename Tree>
+void interleaved_row(const std::string &tree_name, const std::vector<int> &insert_data, const std::vector<int> &queries,
+                     std::size_t batch, std::size_t in_flight)
+{
+    Tree tree;
+    for (int val : insert_data)
+        tree.add(val);
+    std::unique_ptr<bool[]> out(new bool[batch]);
+
+    auto rate = [&](auto lookup)
+    {
+        std::size_t hits = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::size_t base = 0; base < queries.size(); base += batch)
+        {
+            std::size_t n = std::min(batch, queries.size() - base);
+            lookup(std::span<const int>(queries).subspan(base, n), std::span<bool>(out.get(), n));
+            hits += std::count(out.get(), out.get() + n, true);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (hits != queries.size())
+            std::cout << "lookups missed keys of " << tree_name << "\n";
+        return queries.size() / elapsed.count() / 1e6;
+    };
+
+    double single = rate([&](std::span<const int> keys, std::span<bool> found)
+    {
+        for (std::size_t i = 0; i < keys.size(); i++)
+            found[i] = tree.find(keys[i]);
+    });
+    double batched = rate([&](std::span<const int> keys, std::span<bool> found) { tree.find_batch(keys, found); });
+    double coroutines = rate([&](std::span<const int> keys, std::span<bool> found) { tree.find_interleaved(keys, found, in_flight); });
+
+    std::cout << "| " << std::left << std::setw(16) << tree_name << std::right << std::fixed << std::setprecision(2) << "| " << std::setw(8)
+              << single << " | " << std::setw(10) << batched << " | " << std::setw(10) << coroutines << " | " << std::setw(7)
+              << coroutines / single << "x |\n";
+    report.add("interleaved", tree_name, "find", "Mops/s", single);
+    report.add("interleaved", tree_name, "find_batch", "Mops/s", batched);
+    report.add("interleaved", tree_name, "find_interleaved", "Mops/s", coroutines);
+}
 
-int main()
+/**
+ * @brief Coroutine lookups against the plain find loop and group prefetching, in Mops/s. Every lookup is a
+ * task that suspends after prefetching its next node, with `in_flight` tasks resumed round-robin. Like
+ * find_batch this only pays off on trees well beyond the LLC - run with `--sizes=1e6,1e7` or larger.
+ */
+void run_interleaved_benchmark(const std::vector<int> &insert_data, std::size_t batch = 256, std::size_t in_flight = FIND_BATCH_GROUP)
 {
-    // --- Data Preparation ---
-    std::vector<int> random_data(NUM_ELEMENTS);
-    std::vector<int> sorted_data(NUM_ELEMENTS);
-    std::vector<int> search_miss_data(NUM_ELEMENTS);
+    std::vector<int> queries = insert_data;
+    std::shuffle(queries.begin(), queries.end(), std::mt19937(99));
 
-    std::mt19937 gen(1337); // Fixed seed for reproducibility
-    std::uniform_int_distribution<> distrib(0, NUM_ELEMENTS * 5);
+    const std::string header = "| Tree Type       |     find | find_batch | coroutines | Speed-up |";
+    std::cout << "\n--- Coroutine-Interleaved Lookups in Mops/s (" << insert_data.size() << " elements, " << in_flight << " in flight) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+    interleaved_row<RBTree<int>>("RB Tree", insert_data, queries, batch, in_flight);
+    interleaved_row<BTree<int, B_TREE_ORDER>>("B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")", insert_data, queries, batch, in_flight);
+    std::cout << std::string(header.size(), '-') << "\n";
+}
 
-    for (int i = 0; i < NUM_ELEMENTS; ++i)
+/**
+ * @brief Times ordered range scans [lo, hi) over a B+Tree's leaf chain against std::set iteration.
+ * Each query sums the keys it visits so the scan cannot be optimised away.
+ */
+void run_scan_benchmark(const std::vector<int> &insert_data)
+{
+    const int num_queries = 100, span = std::max<int>(1, insert_data.size() / 10);
+    BPlusTree<int, B_TREE_ORDER> bplus_tree;
+    std::set<int> std_set;
+    for (int val : insert_data)
     {
-        sorted_data[i] = i;
-        random_data[i] = i;
-        search_miss_data[i] = distrib(gen); // Values likely not in the trees
+        bplus_tree.add(val);
+        std_set.insert(val);
     }
-    std::shuffle(random_data.begin(), random_data.end(), gen);
-    std::vector<int> random_delete_data = random_data;
-    std::shuffle(random_delete_data.begin(), random_delete_data.end(), gen);
 
-    // --- Tree Instantiation ---
-    std::vector<std::unique_ptr<IBenchmarkableTree>> trees;
-    trees.push_back(std::make_unique<CppTreeWrapper<AVLTree<int>>>("AVL Tree"));
-    trees.push_back(std::make_unique<CppTreeWrapper<RBTree<int>>>("RB Tree"));
-    trees.push_back(std::make_unique<CppTreeWrapper<SplayTree<int>>>("Splay Tree"));
-    trees.push_back(std::make_unique<CppTreeWrapper<BTree<int, B_TREE_ORDER>>>(
-        "B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")"));
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> distrib(0, std::max<int>(0, insert_data.size() - span));
+    std::vector<int> starts(num_queries);
+    for (int &lo : starts)
+        lo = distrib(gen);
 
-    // --- Run Benchmarks ---
-    auto run_test_set = [&](const std::string &test_name, const std::vector<int> &data_set)
+    auto time_scans = [&](const std::string &name, auto scan)
     {
-        std::cout << "\n--- Benchmarking on " << test_name << " (" << NUM_ELEMENTS << " elements) ---\n";
-        std::cout << "-----------------------------------------------------------------------------\n";
-        std::cout << "| Tree Type       |      Insert |   Find (Hit) |  Find (Miss) |       Remove |\n";
-        std::cout << "-----------------------------------------------------------------------------\n";
+        long long checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int lo : starts)
+            checksum += scan(lo, lo + span);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> duration = end - start;
 
-        for (const auto &tree : trees)
+        std::cout << "| " << std::left << std::setw(15) << name
+                  << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << duration.count() << " ms "
+                  << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << num_queries * span / duration.count() / 1000 << " M/s "
+                  << "| " << std::right << std::setw(14) << checksum << " |" << std::endl;
+        report.add("range_scan", name, "total", "ms", duration.count());
+        report.add("range_scan", name, "throughput", "Mkeys/s", num_queries * span / duration.count() / 1000);
+    };
+
+    std::cout << "\n--- Range Scans (" << num_queries << " scans of " << span << " keys) ---\n";
+    std::cout << "------------------------------------------------------------------\n";
+    std::cout << "| Tree Type      |         Total |     Throughput |       Checksum |\n";
+    std::cout << "------------------------------------------------------------------\n";
+    time_scans("B+Tree (N=" + std::to_string(B_TREE_ORDER) + ")", [&](int lo, int hi)
+               {
+        long long sum = 0;
+        for (int val : bplus_tree.range(lo, hi))
+            sum += val;
+        return sum; });
+    time_scans("std::set", [&](int lo, int hi)
+               {
+        long long sum = 0;
+        for (auto it = std_set.lower_bound(lo), last = std_set.lower_bound(hi); it != last; ++it)
+            sum += *it;
+        return sum; });
+    std::cout << "------------------------------------------------------------------\n";
+}
+
+/**
+ * @brief Splay finger search on sorted and near-sorted streams - each policy driven through add/find
+ * (every access from the root) and through add_near/find_near (from the previous access). Cells are Mops/s.
+ */
+void run_finger_benchmark(const std::vector<int> &sorted_data)
+{
+    // Sorted, with every key displaced by up to 8 positions
+    std::vector<int> near_sorted = sorted_data;
+    std::mt19937 gen(7);
+    for (std::size_t i = 0; i + 1 < near_sorted.size(); ++i)
+        std::swap(near_sorted[i], near_sorted[std::min(near_sorted.size() - 1, i + gen() % 8)]);
+
+    auto time_policy = [&]<typename Policy>(const std::string &name)
+    {
+        for (bool near : {false, true})
         {
-            BenchmarkResults results;
-            run_benchmark(*tree, data_set, search_miss_data, results);
-            print_results(tree->name(), results);
+            SplayTree<int, std::less<int>, NodePool<int>, NoStats, BottomUpSplay, Policy> tree;
+            auto add = [&](int val) { return near ? tree.add_near(val) : tree.add(val); };
+            auto find = [&](int val) { return near ? tree.find_near(val) : tree.find(val); };
+            std::size_t hits = 0;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int val : sorted_data)
+                hits += add(val);
+            auto inserted = std::chrono::high_resolution_clock::now();
+            for (int val : sorted_data)
+                hits += find(val);
+            auto sorted_end = std::chrono::high_resolution_clock::now();
+            for (int val : near_sorted)
+                hits += find(val);
+            auto end = std::chrono::high_resolution_clock::now();
+            volatile std::size_t found = hits; // Keeps the lookups from being optimised away
+            (void)found;
+
+            std::string row = name + (near ? " / finger" : " / root");
+            std::chrono::duration<double, std::micro> insert_time = inserted - start, sorted_time = sorted_end - inserted, near_time = end - sorted_end;
+            std::cout << "| " << std::left << std::setw(26) << row
+                      << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << sorted_data.size() / insert_time.count() << " "
+                      << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << sorted_data.size() / sorted_time.count() << " "
+                      << "| " << std::right << std::setw(11) << std::fixed << std::setprecision(2) << near_sorted.size() / near_time.count() << " |" << std::endl;
+            report.add("finger", row, "insert_sorted", "Mops/s", sorted_data.size() / insert_time.count());
+            report.add("finger", row, "find_sorted", "Mops/s", sorted_data.size() / sorted_time.count());
+            report.add("finger", row, "find_near_sorted", "Mops/s", near_sorted.size() / near_time.count());
         }
+    };
 
-        BenchmarkResults results;
-        run_benchmark(data_set, search_miss_data, results);
-        print_results("std::set", results);
-        std::cout << "-----------------------------------------------------------------------------\n";
+    const std::string header = "| Splay policy / start      |     Insert |       Find | Find (near) |";
+    std::cout << "\n--- Splay Finger Search on Sorted Data in Mops/s (" << sorted_data.size() << " elements) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+    time_policy.operator()<FullSplay>("Full");
+    time_policy.operator()<SemiSplay>("Semi");
+    time_policy.operator()<DepthSplay<>>("Depth > 2 log n");
+    time_policy.operator()<CountingSplay<>>("Every 8th access");
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief Startup cost of building each tree from a sorted snapshot - `from_sorted` bulk load against
+ * one `add` per key. Both builds are kept alive until timed so destruction is not measured.
+ */
+void run_bulk_load_benchmark(const std::vector<int> &sorted_data)
+{
+    auto time_build = [&]<typename TreeType>(const std::string &name)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        TreeType added;
+        for (int val : sorted_data)
+            added.add(val);
+        auto mid = std::chrono::high_resolution_clock::now();
+        TreeType loaded = TreeType::from_sorted(sorted_data.begin(), sorted_data.end());
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double, std::milli> add_time = mid - start, load_time = end - mid;
+        std::cout << "| " << std::left << std::setw(15) << name
+                  << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << add_time.count() << " ms "
+                  << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << load_time.count() << " ms "
+                  << "| " << std::right << std::setw(9) << std::fixed << std::setprecision(1) << add_time / load_time << "x |" << std::endl;
+        report.add("bulk_load", name, "repeated_add", "ms", add_time.count());
+        report.add("bulk_load", name, "from_sorted", "ms", load_time.count());
+    };
+
+    std::cout << "\n--- Bulk Load from Sorted Data (" << sorted_data.size() << " elements) ---\n";
+    std::cout << "---------------------------------------------------------------\n";
+    std::cout << "| Tree Type      |  Repeated add |   from_sorted |    Speedup |\n";
+    std::cout << "---------------------------------------------------------------\n";
+    time_build.operator()<AVLTree<int>>("AVL Tree");
+    time_build.operator()<RBTree<int>>("RB Tree");
+    time_build.operator()<SplayTree<int>>("Splay Tree");
+    time_build.operator()<BTree<int, B_TREE_ORDER>>("B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")");
+    std::cout << "---------------------------------------------------------------\n";
+}
+
+/**
+ * @brief Insert/remove throughput of the binary trees on the default slab NodePool against plain
+ * `std::allocator` (global new/delete per node), plus the cost of `clear()` on a full tree.
+ */
+void run_allocator_benchmark(const std::vector<int> &insert_data)
+{
+    std::vector<int> remove_data = insert_data;
+    std::shuffle(remove_data.begin(), remove_data.end(), std::mt19937(99));
+
+    auto time_churn = [&]<typename TreeType>(const std::string &name)
+    {
+        TreeType tree;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int val : insert_data)
+            tree.add(val);
+        auto mid = std::chrono::high_resolution_clock::now();
+        for (int val : remove_data)
+            tree.remove(val);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        for (int val : insert_data)
+            tree.add(val);
+        auto clear_start = std::chrono::high_resolution_clock::now();
+        tree.clear();
+        auto clear_end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double, std::milli> insert_time = mid - start, remove_time = end - mid, clear_time = clear_end - clear_start;
+        std::cout << "| " << std::left << std::setw(22) << name
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << insert_data.size() / insert_time.count() / 1000 << " M/s "
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << remove_data.size() / remove_time.count() / 1000 << " M/s "
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << clear_time.count() << " ms |" << std::endl;
+        report.add("allocator", name, "insert", "Mops/s", insert_data.size() / insert_time.count() / 1000);
+        report.add("allocator", name, "remove", "Mops/s", remove_data.size() / remove_time.count() / 1000);
+        report.add("allocator", name, "clear", "ms", clear_time.count());
+    };
+
+    const std::string header = "| Tree Type             |       Insert |       Remove |       Clear |";
+    std::cout << "\n--- Node Allocation: NodePool vs std::allocator (" << insert_data.size() << " elements) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+    time_churn.operator()<AVLTree<int>>("AVL Tree (pool)");
+    time_churn.operator()<AVLTree<int, std::less<int>, std::allocator<int>>>("AVL Tree (new)");
+    time_churn.operator()<RBTree<int>>("RB Tree (pool)");
+    time_churn.operator()<RBTree<int, std::less<int>, std::allocator<int>>>("RB Tree (new)");
+    time_churn.operator()<SplayTree<int>>("Splay Tree (pool)");
+    time_churn.operator()<SplayTree<int, std::less<int>, std::allocator<int>>>("Splay Tree (new)");
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief Insert and hit-lookup throughput on long string keys sharing a prefix, comparing the default
+ * `std::less<std::string>` (one `operator<=>` per node) with an opaque bool comparator (two calls per node).
+ */
+void run_string_key_benchmark(const std::vector<int> &insert_data)
+{
+    std::vector<std::string> keys;
+    keys.reserve(insert_data.size());
+    for (int val : insert_data)
+    {
+        std::string digits = std::to_string(val);
+        keys.push_back("tenant/region/cluster/service/instance/" + std::string(12 - digits.size(), '0') + digits);
+    }
+
+    auto time_keys = [&]<typename TreeType>(const std::string &name)
+    {
+        TreeType tree;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const std::string &key : keys)
+            tree.add(key);
+        auto mid = std::chrono::high_resolution_clock::now();
+        std::size_t hits = 0;
+        for (const std::string &key : keys)
+            hits += tree.find(key);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        if (hits != keys.size())
+            std::cerr << name << ": missed " << keys.size() - hits << " keys\n";
+
+        std::chrono::duration<double, std::milli> insert_time = mid - start, find_time = end - mid;
+        std::cout << "| " << std::left << std::setw(22) << name
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << keys.size() / insert_time.count() / 1000 << " M/s "
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << keys.size() / find_time.count() / 1000 << " M/s |" << std::endl;
+        report.add("string_keys", name, "insert", "Mops/s", keys.size() / insert_time.count() / 1000);
+        report.add("string_keys", name, "find_hit", "Mops/s", keys.size() / find_time.count() / 1000);
+    };
+
+    const std::string header = "| Tree Type             |       Insert |   Find (Hit) |";
+    std::cout << "\n--- String Keys: three-way vs two-call comparison (" << keys.size() << " keys) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+    time_keys.operator()<AVLTree<std::string>>("AVL Tree (<=>)");
+    time_keys.operator()<AVLTree<std::string, StringLess>>("AVL Tree (less)");
+    time_keys.operator()<RBTree<std::string>>("RB Tree (<=>)");
+    time_keys.operator()<RBTree<std::string, StringLess>>("RB Tree (less)");
+    time_keys.operator()<SplayTree<std::string>>("Splay Tree (<=>)");
+    time_keys.operator()<SplayTree<std::string, StringLess>>("Splay Tree (less)");
+    time_keys.operator()<BTree<std::string, B_TREE_ORDER>>("B-Tree (<=>)");
+    time_keys.operator()<BTree<std::string, B_TREE_ORDER, StringLess>>("B-Tree (less)");
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief Plain against packed node layouts (`PackedLayout`: colour or balance factor in a pointer's low bits)
+ * for the binary trees, with `int` and 64-bit keys - an `int` RB node already fits its colour into the key's
+ * padding, a 64-bit one does not. Lookups run in shuffled order, so the gain shows once the tree outgrows
+ * the last-level cache.
+ */
+void run_layout_benchmark(const std::vector<int> &insert_data)
+{
+    std::vector<int> queries = insert_data;
+    std::shuffle(queries.begin(), queries.end(), std::mt19937(7));
+
+    auto time_layout = [&]<typename TreeType, typename Key>(const std::string &name)
+    {
+        TreeType tree;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int val : insert_data)
+            tree.add(static_cast<Key>(val));
+        auto mid = std::chrono::high_resolution_clock::now();
+        std::size_t hits = 0;
+        for (int val : queries)
+            hits += tree.find(static_cast<Key>(val));
+        auto end = std::chrono::high_resolution_clock::now();
+
+        if (hits != queries.size())
+            std::cerr << name << ": missed " << queries.size() - hits << " keys\n";
+
+        auto usage = tree.memory_usage();
+        double node_bytes = usage.nodes ? static_cast<double>(usage.bytes) / usage.nodes : 0;
+        std::chrono::duration<double, std::milli> insert_time = mid - start, find_time = end - mid;
+        std::cout << "| " << std::left << std::setw(27) << name
+                  << "| " << std::right << std::setw(6) << std::fixed << std::setprecision(0) << node_bytes << " B "
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << insert_data.size() / insert_time.count() / 1000 << " M/s "
+                  << "| " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << queries.size() / find_time.count() / 1000 << " M/s |" << std::endl;
+        report.add("node_layout", name, "node", "bytes", node_bytes);
+        report.add("node_layout", name, "insert", "Mops/s", insert_data.size() / insert_time.count() / 1000);
+        report.add("node_layout", name, "find_hit", "Mops/s", queries.size() / find_time.count() / 1000);
     };
 
-    run_test_set("Randomly Ordered Data", random_data);
-    run_test_set("Sequentially Ordered Data", sorted_data);
+    using Wide = std::int64_t;
+    const std::string header = "| Tree Type (layout, key)    |     Node |       Insert |   Find (Hit) |";
+    std::cout << "\n--- Node Layout: plain vs packed balance bits (" << insert_data.size() << " keys) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+    time_layout.operator()<AVLTree<int>, int>("AVL Tree (plain, int)");
+    time_layout.operator()<AVLTree<int, std::less<int>, NodePool<int>, NoStats, PackedLayout>, int>("AVL Tree (packed, int)");
+    time_layout.operator()<AVLTree<Wide>, Wide>("AVL Tree (plain, int64)");
+    time_layout.operator()<AVLTree<Wide, std::less<Wide>, NodePool<Wide>, NoStats, PackedLayout>, Wide>("AVL Tree (packed, int64)");
+    time_layout.operator()<RBTree<int>, int>("RB Tree (plain, int)");
+    time_layout.operator()<RBTree<int, std::less<int>, NodePool<int>, NoStats, PackedLayout>, int>("RB Tree (packed, int)");
+    time_layout.operator()<RBTree<Wide>, Wide>("RB Tree (plain, int64)");
+    time_layout.operator()<RBTree<Wide, std::less<Wide>, NodePool<Wide>, NoStats, PackedLayout>, Wide>("RB Tree (packed, int64)");
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief Reports B-Tree bytes per key with the split leaf/internal layout, next to what the same nodes
+ * cost when every leaf also carried the `2 * N` child pointer array (the previous uniform layout).
+ */
+void report_btree_memory(const std::vector<int> &insert_data)
+{
+    BTree<int, B_TREE_ORDER> tree;
+    for (int val : insert_data)
+        tree.add(val);
+
+    auto usage = tree.memory_usage();
+    std::size_t uniform_bytes = usage.bytes + usage.leaves * 2 * B_TREE_ORDER * sizeof(void *);
+
+    std::cout << "\n--- B-Tree (N=" << B_TREE_ORDER << ") Memory Footprint (" << usage.keys << " keys, "
+              << usage.leaves << " leaves, " << usage.internals << " internal nodes) ---\n";
+    std::cout << "Uniform nodes    : " << std::fixed << std::setprecision(2) << static_cast<double>(uniform_bytes) / usage.keys << " bytes/key\n";
+    std::cout << "Leaf/internal    : " << std::fixed << std::setprecision(2) << static_cast<double>(usage.bytes) / usage.keys << " bytes/key\n";
+    report.add("memory", "B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")", "uniform_nodes", "bytes/key", static_cast<double>(uniform_bytes) / usage.keys);
+    report.add("memory", "B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")", "leaf_internal", "bytes/key", static_cast<double>(usage.bytes) / usage.keys);
+}
+
+/**
+ * @brief One tree's rows of the structural statistics table: the four phases of `run_benchmark`, each with
+ * the tree's `TreeStats` counters divided by the number of operations in it.
+ */
+template <typename Tree>
+void print_structure_stats(const std::string &tree_name, const std::vector<int> &insert_data, const std::vector<int> &search_miss_data)
+{
+    Tree tree;
+    auto phase = [&](const std::string &operation, const std::vector<int> &data, auto op)
+    {
+        tree.reset_stats();
+        for (int val : data)
+            op(val);
+
+        const TreeStats &stats = tree.stats();
+        const double ops = static_cast<double>(data.size());
+        std::pair<const char *, double> values[] = {
+            {"comparisons", stats.comparisons / ops}, {"visits", stats.visits / ops}, {"rotations", stats.rotations / ops},
+            {"splits", stats.splits / ops},           {"merges", stats.merges / ops}, {"borrows", stats.borrows / ops},
+            {"splay_depth", stats.splays ? static_cast<double>(stats.splay_depth) / stats.splays : 0}};
+
+        std::cout << "| " << std::left << std::setw(16) << tree_name << "| " << std::setw(11) << operation << std::right << std::fixed << std::setprecision(2);
+        for (auto [metric, value] : values)
+        {
+            std::cout << "| " << std::setw(metric == values[6].first ? 11 : 8) << value << " ";
+            report.add("stats", tree_name, operation + "." + metric, "events/op", value);
+        }
+        std::cout << "|\n";
+    };
+
+    phase("insert", insert_data, [&](int val) { tree.add(val); });
+    phase("find hit", insert_data, [&](int val) { tree.find(val); });
+    phase("find miss", search_miss_data, [&](int val) { tree.find(val); });
+    phase("remove", insert_data, [&](int val) { tree.remove(val); });
+}
+
+/**
+ * @brief Comparisons, node visits and restructuring work per operation, counted by instantiating every tree
+ * with the `TreeStats` policy. B-Trees use `ScalarLess` here, since the vectorised rank makes no comparator
+ * calls, and run at several orders to show how the order trades comparisons against splits and merges.
+ */
+void run_structure_stats(const std::vector<int> &insert_data, const std::vector<int> &search_miss_data)
+{
+    const std::string header = "| Tree Type       | Operation  |      cmp |   visits |  rotates |   splits |   merges |  borrows | splay depth |";
+    std::cout << "\n--- Structural Statistics per Operation (" << insert_data.size() << " random elements) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    print_structure_stats<AVLTree<int, std::less<int>, NodePool<int>, TreeStats>>("AVL Tree", insert_data, search_miss_data);
+    print_structure_stats<RBTree<int, std::less<int>, NodePool<int>, TreeStats>>("RB Tree", insert_data, search_miss_data);
+    print_structure_stats<SplayTree<int, std::less<int>, NodePool<int>, TreeStats>>("Splay Tree", insert_data, search_miss_data);
+    print_structure_stats<SplayTree<int, std::less<int>, NodePool<int>, TreeStats, TopDownSplay>>("Splay top-down", insert_data, search_miss_data);
+    print_structure_stats<BTree<int, 4, ScalarLess, TreeStats>>("B-Tree (N=4)", insert_data, search_miss_data);
+    print_structure_stats<BTree<int, B_TREE_ORDER, ScalarLess, TreeStats>>("B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")", insert_data, search_miss_data);
+    print_structure_stats<BTree<int, 64, ScalarLess, TreeStats>>("B-Tree (N=64)", insert_data, search_miss_data);
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief Tail latency table - p50/p90/p99/p99.9/max in nanoseconds for every operation of every tree,
+ * plus the cost of an empty timestamp pair, which every sample includes.
+ */
+void run_latency_report(const std::vector<std::unique_ptr<IBenchmarkableTree>> &trees, const std::vector<int> &insert_data,
+                        const std::vector<int> &search_miss_data)
+{
+    LatencyHistogram overhead;
+    for (int i = 0; i < 100'000; ++i)
+    {
+        std::uint64_t start = Ticks::now();
+        overhead.record(Ticks::stop() - start);
+    }
+
+    const double ns = Ticks::ns_per_tick();
+    const std::string header = "| Tree Type       | Operation  |      p50 |      p90 |      p99 |    p99.9 |        max |";
+    std::cout << "\n--- Per-Operation Latency in ns (" << insert_data.size() << " random elements, timer overhead ~"
+              << std::fixed << std::setprecision(0) << overhead.percentile(50) * ns << " ns) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    auto print = [&](const std::string &tree_name, const LatencyResults &results)
+    {
+        std::tuple<const char *, const char *, const LatencyHistogram *> rows[] = {
+            {"insert", "insert", &results.insert}, {"find hit", "find_hit", &results.find_hit},
+            {"find miss", "find_miss", &results.find_miss}, {"remove", "remove", &results.remove}};
+        for (auto [operation, metric, histogram] : rows)
+        {
+            std::cout << "| " << std::left << std::setw(16) << tree_name << "| " << std::setw(11) << operation << std::right << std::fixed << std::setprecision(0);
+            for (auto [p, label] : {std::pair{50.0, ".p50"}, {90.0, ".p90"}, {99.0, ".p99"}, {99.9, ".p99.9"}})
+            {
+                std::cout << "| " << std::setw(8) << histogram->percentile(p) * ns << " ";
+                report.add("latency", tree_name, metric + std::string(label), "ns", histogram->percentile(p) * ns);
+            }
+            std::cout << "| " << std::setw(10) << histogram->max() * ns << " |\n";
+            report.add("latency", tree_name, metric + std::string(".max"), "ns", histogram->max() * ns);
+        }
+    };
+
+    for (const auto &tree : trees)
+    {
+        tree->clear();
+        LatencyResults results;
+        run_latency_benchmark([&](int val) { return tree->add(val); }, [&](int val) { return tree->find(val); },
+                              [&](int val) { return tree->remove(val); }, insert_data, search_miss_data, results);
+        print(tree->name(), results);
+    }
+
+    std::set<int> std_set;
+    LatencyResults results;
+    run_latency_benchmark([&](int val) { return std_set.insert(val).second; }, [&](int val) { return std_set.contains(val); },
+                          [&](int val) { return std_set.erase(val) > 0; }, insert_data, search_miss_data, results);
+    print("std::set", results);
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+// std::set behind the add/find/remove interface of the trees
+template <typename Key>
+struct SetTree
+{
+    std::set<Key> set;
+    bool add(const Key &key) { return set.insert(key).second; }
+    bool find(const Key &key) const { return set.contains(key); }
+    bool remove(const Key &key) { return set.erase(key) > 0; }
+};
+
+/**
+ * @brief Replays a workload's operation stream on a tree (already preloaded) and returns how many
+ * operations succeeded, so no call can be optimised away.
+ */
+template <typename Tree>
+std::size_t replay(Tree &tree, const Workload &workload)
+{
+    std::size_t successes = 0;
+    for (const Operation &op : workload.ops)
+    {
+        switch (op.type)
+        {
+        case OpType::READ:
+            successes += tree.find(op.key);
+            break;
+        case OpType::UPDATE:
+            successes += tree.remove(op.key) && tree.add(op.key);
+            break;
+        case OpType::INSERT:
+            successes += tree.add(op.key);
+            break;
+        case OpType::REMOVE:
+            successes += tree.remove(op.key);
+            break;
+        case OpType::SCAN:
+            for (int key = op.key; key < op.key + op.length; ++key)
+                successes += tree.find(key);
+            break;
+        case OpType::READ_MODIFY_WRITE:
+            if (tree.find(op.key))
+                successes += tree.remove(op.key) && tree.add(op.key);
+            break;
+        }
+    }
+    return successes;
+}
+
+/**
+ * @brief Skewed and mixed workloads - the YCSB core mixes, a drifting hot set and a sawtooth of appends
+ * and expiries - replayed on every tree from the same seeded operation streams. Cells are Mops/s.
+ */
+void run_workload_benchmark(const std::vector<std::unique_ptr<IBenchmarkableTree>> &trees, int records, std::uint64_t seed)
+{
+    const int operations = 2 * records;
+    std::vector<Workload> workloads;
+    for (char mix : std::string("ABCDEF"))
+        workloads.push_back(make_ycsb(mix, records, operations, seed));
+    workloads.push_back(make_ycsb('C', records, operations, seed, true));
+    workloads.push_back(make_hot_set(records, operations, seed));
+    workloads.push_back(make_sawtooth(records, operations, seed));
+
+    std::string header = "| Workload            |";
+    for (const auto &tree : trees)
+        header += " " + std::string(std::max<int>(0, 15 - tree->name().size()), ' ') + tree->name() + " |";
+
+    std::cout << "\n--- Workloads in Mops/s (" << records << " records, " << operations << " ops, seed " << seed << ") ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    for (const Workload &workload : workloads)
+    {
+        // std::set sets the success count every tree has to match, so a broken tree can't post a fast number
+        SetTree<int> reference;
+        for (int key : workload.preload)
+            reference.add(key);
+        const std::size_t expected = replay(reference, workload);
+
+        std::cout << "| " << std::left << std::setw(20) << workload.name << "|" << std::right << std::flush;
+        for (const auto &tree : trees)
+        {
+            tree->clear();
+            for (int key : workload.preload)
+                tree->add(key);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::size_t successes = replay(*tree, workload);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            if (successes != expected)
+                std::cerr << tree->name() << " on " << workload.name << ": unexpected result count\n";
+
+            std::chrono::duration<double, std::micro> elapsed = end - start;
+            std::cout << " " << std::setw(std::max<int>(15, tree->name().size())) << std::fixed << std::setprecision(2)
+                      << workload.ops.size() / elapsed.count() << " |" << std::flush;
+            report.add("workloads", tree->name(), workload.name, "Mops/s", workload.ops.size() / elapsed.count());
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief Splay policies on read-only Zipfian and uniform streams - how much restructuring each policy
+ * does and what it buys. Cells are Mops/s with rotations per lookup in brackets; the rotations come
+ * from a second, instrumented replay so the counters stay out of the timings.
+ */
+void run_splay_policy_benchmark(int records, std::uint64_t seed)
+{
+    const int operations = 2 * records;
+    std::vector<Workload> workloads = {make_ycsb('C', records, operations, seed), make_ycsb('C', records, operations, seed, true),
+                                       make_uniform_reads(records, operations, seed)};
+
+    std::string header = "| Splay policy             |";
+    for (const Workload &workload : workloads)
+        header += " " + std::string(20 - workload.name.size(), ' ') + workload.name + " |";
+
+    std::cout << "\n--- Splay Policies on Reads in Mops/s (rotations/lookup) (" << records << " records, " << operations << " lookups) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    auto row = [&]<typename Engine, typename Policy>(const std::string &name)
+    {
+        std::cout << "| " << std::left << std::setw(25) << name << "|" << std::right << std::flush;
+        for (const Workload &workload : workloads)
+        {
+            SplayTree<int, std::less<int>, NodePool<int>, NoStats, Engine, Policy> tree;
+            SplayTree<int, std::less<int>, NodePool<int>, TreeStats, Engine, Policy> counted;
+            for (int key : workload.preload)
+            {
+                tree.add(key);
+                counted.add(key);
+            }
+
+            std::size_t hits = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const Operation &op : workload.ops)
+                hits += tree.find(op.key);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            counted.reset_stats();
+            for (const Operation &op : workload.ops)
+                hits += counted.find(op.key);
+            volatile std::size_t found = hits; // Keeps the lookups from being optimised away
+            (void)found;
+
+            std::chrono::duration<double, std::micro> elapsed = end - start;
+            double rate = workload.ops.size() / elapsed.count();
+            double rotations = static_cast<double>(counted.stats().rotations) / workload.ops.size();
+            std::cout << " " << std::setw(11) << std::fixed << std::setprecision(2) << rate << " (" << std::setw(6) << std::setprecision(2) << rotations
+                      << ") |" << std::flush;
+            report.add("splay_policy", name, workload.name, "Mops/s", rate);
+            report.add("splay_policy", name, workload.name, "rotations/op", rotations);
+        }
+        std::cout << "\n";
+    };
+
+    row.operator()<BottomUpSplay, FullSplay>("Full");
+    row.operator()<BottomUpSplay, SemiSplay>("Semi");
+    row.operator()<BottomUpSplay, DepthSplay<>>("Depth > 2 log n");
+    row.operator()<BottomUpSplay, CountingSplay<>>("Every 8th access");
+    row.operator()<TopDownSplay, FullSplay>("Top-down full");
+    row.operator()<TopDownSplay, DepthSplay<>>("Top-down depth > 2 log n");
+    row.operator()<TopDownSplay, CountingSplay<>>("Top-down every 8th");
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+/**
+ * @brief SplayCache against a hash-map LRU in front of a `records`-key store, under Zipfian traffic
+ * (plain and scrambled) and a sequential scan, at a few capacities. Every miss is filled with put, as a
+ * read-through cache would. Cells are the hit ratio and Mops/s.
+ */
+void run_cache_benchmark(int records, std::uint64_t seed)
+{
+    const int operations = 2 * records;
+    std::vector<std::pair<std::string, std::vector<int>>> streams;
+    for (bool scrambled : {false, true})
+    {
+        std::mt19937_64 rng(seed);
+        ZipfianGenerator zipf(records);
+        ScrambledZipfianGenerator scrambled_zipf(records);
+        std::vector<int> keys(operations);
+        for (int &key : keys)
+            key = static_cast<int>(scrambled ? scrambled_zipf(rng) : zipf(rng));
+        streams.emplace_back(scrambled ? "Zipf scrambled" : "Zipf", std::move(keys));
+    }
+
+    // A sequential scan - no hits, and a fill order that leaves a splay tree a single path
+    std::vector<int> scan(operations);
+    for (int i = 0; i < operations; ++i)
+        scan[i] = i % records;
+    streams.emplace_back("Scan", std::move(scan));
+
+    std::string header = "| Cache (capacity)       |";
+    for (const auto &[name, keys] : streams)
+        header += " " + std::string(21 - name.size(), ' ') + name + " |";
+
+    std::cout << "\n--- Read-through Caches: hit ratio, Mops/s (" << records << " keys, " << operations << " accesses) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    auto row = [&]<typename Cache>(const std::string &name, double fraction)
+    {
+        std::size_t capacity = std::max<std::size_t>(1, records * fraction);
+        std::string label = name + " (" + std::to_string(static_cast<int>(fraction * 100)) + "%)";
+        std::cout << "| " << std::left << std::setw(23) << label << "|" << std::right << std::flush;
+        for (const auto &[stream, keys] : streams)
+        {
+            Cache cache(capacity);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int key : keys)
+                if (cache.get(key) == nullptr)
+                    cache.put(key, key);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::chrono::duration<double, std::micro> elapsed = end - start;
+            std::cout << "     " << std::setw(6) << std::fixed << std::setprecision(3) << cache.hit_ratio() << ", " << std::setw(8)
+                      << std::setprecision(2) << keys.size() / elapsed.count() << " |" << std::flush;
+            report.add("cache", label, stream, "hit ratio", cache.hit_ratio());
+            report.add("cache", label, stream, "Mops/s", keys.size() / elapsed.count());
+        }
+        std::cout << "\n";
+    };
+
+    for (double fraction : {0.01, 0.1})
+    {
+        row.operator()<SplayCache<int, int>>("SplayCache", fraction);
+        row.operator()<LruCache<int, int>>("LRU hash map", fraction);
+    }
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+void print_results(const std::string &tree_name, const BenchmarkResults &results)
+{
+    std::cout << "| " << std::left << std::setw(16) << tree_name
+              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.insert_time.count() << " ms "
+              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.find_hit_time.count() << " ms "
+              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.find_miss_time.count() << " ms "
+              << "| " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << results.remove_time.count() << " ms "
+              << "| " << std::right << std::setw(9) << std::fixed << std::setprecision(1) << results.memory.bytes_per_key() << " "
+              << "| " << std::right << std::setw(5) << std::fixed << std::setprecision(2) << results.memory.fill << " |"
+              << std::endl;
+}
+
+/**
+ * @brief Hardware counters of every phase, divided by the number of operations in it. Events this machine
+ * could not count print as n/a.
+ */
+void print_counters(const std::string &suite, const std::vector<std::pair<std::string, BenchmarkResults>> &rows, std::size_t insert_ops,
+                    std::size_t miss_ops)
+{
+    const std::string header = "| Tree Type       | Phase      |   cycles |    instr |   IPC | L1D miss | LLC miss |  br miss | dTLB miss |";
+    std::cout << "Hardware counters per operation:\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    auto cell = [](double value, std::size_t ops, int width)
+    {
+        if (value < 0)
+            std::cout << "| " << std::setw(width) << "n/a" << " ";
+        else
+            std::cout << "| " << std::setw(width) << std::fixed << std::setprecision(2) << value / ops << " ";
+    };
+
+    for (const auto &[tree_name, results] : rows)
+    {
+        std::tuple<const char *, const PhaseCounters *, std::size_t> phases[] = {
+            {"insert", &results.insert_counters, insert_ops},
+            {"find hit", &results.find_hit_counters, insert_ops},
+            {"find miss", &results.find_miss_counters, miss_ops},
+            {"remove", &results.remove_counters, insert_ops}};
+
+        for (auto [phase, counters, ops] : phases)
+        {
+            const auto &v = counters->values;
+            const char *event_names[] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"};
+            for (int e = 0; e < PhaseCounters::EVENT_COUNT; ++e)
+                if (v[e] >= 0)
+                    report.add(suite + ":counters", tree_name, std::string(phase) + "." + event_names[e], "events/op", v[e] / ops);
+            std::cout << "| " << std::left << std::setw(16) << tree_name << "| " << std::setw(11) << phase << std::right;
+            cell(v[PhaseCounters::CYCLES], ops, 8);
+            cell(v[PhaseCounters::INSTRUCTIONS], ops, 8);
+            cell(v[PhaseCounters::CYCLES] > 0 && v[PhaseCounters::INSTRUCTIONS] >= 0 ? v[PhaseCounters::INSTRUCTIONS] / v[PhaseCounters::CYCLES] : -1, 1, 5);
+            cell(v[PhaseCounters::L1D_MISSES], ops, 8);
+            cell(v[PhaseCounters::LLC_MISSES], ops, 8);
+            cell(v[PhaseCounters::BRANCH_MISSES], ops, 8);
+            cell(v[PhaseCounters::DTLB_MISSES], ops, 9);
+            std::cout << "|\n";
+        }
+    }
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+// =================================================================================================
+// 3. CONCURRENT BENCHMARK
+//
+// The sequential trees are not thread-safe, so each one is put behind a locking scheme and driven by N threads
+// with a configurable read/write mix, next to ConcurrentBTree and ConcurrentRBTree, which synchronise
+// themselves. Aggregate throughput per thread count shows where each stops scaling.
+// =================================================================================================
+
+struct ConcurrentConfig
+{
+    int elements = DEFAULT_ELEMENTS;
+    std::vector<int> thread_counts;
+    int read_percent = 90;
+    std::size_t ops_per_thread = 200'000;
+    std::size_t shards = 16;
+};
+
+class IConcurrentTree
+{
+public:
+    virtual ~IConcurrentTree() = default;
+    virtual bool add(int value) = 0;
+    virtual bool find(int value) = 0;
+    virtual bool remove(int value) = 0;
+};
+
+/**
+ * @brief One exclusive lock around every operation.
+ */
+template <typename TreeType>
+class MutexTree : public IConcurrentTree
+{
+public:
+    bool add(int value) override
+    {
+        std::lock_guard lock(mutex);
+        return tree.add(value);
+    }
+
+    bool find(int value) override
+    {
+        std::lock_guard lock(mutex);
+        return tree.find(value);
+    }
+
+    bool remove(int value) override
+    {
+        std::lock_guard lock(mutex);
+        return tree.remove(value);
+    }
+
+private:
+    std::mutex mutex;
+    TreeType tree;
+};
+
+/**
+ * @brief Reader-writer lock - trees with a `const` find share the lock between readers.
+ * Splay find restructures the tree, so there it has to take the lock exclusively just like a write.
+ */
+template <typename TreeType>
+class SharedMutexTree : public IConcurrentTree
+{
+public:
+    static constexpr bool shared_reads = requires(const TreeType &tree, int value) { tree.find(value); };
+
+    bool add(int value) override
+    {
+        std::unique_lock lock(mutex);
+        return tree.add(value);
+    }
+
+    bool find(int value) override
+    {
+        if constexpr (shared_reads)
+        {
+            std::shared_lock lock(mutex);
+            return tree.find(value);
+        }
+        else
+        {
+            std::unique_lock lock(mutex);
+            return tree.find(value);
+        }
+    }
+
+    bool remove(int value) override
+    {
+        std::unique_lock lock(mutex);
+        return tree.remove(value);
+    }
+
+private:
+    std::shared_mutex mutex;
+    TreeType tree;
+};
+
+/**
+ * @brief Keys are hashed onto independent trees, each behind its own reader-writer lock.
+ * A key always maps to the same shard, so point operations stay exact while unrelated keys stop contending.
+ */
+template <typename TreeType>
+class ShardedTree : public IConcurrentTree
+{
+public:
+    explicit ShardedTree(std::size_t count) : shards(count) {}
+
+    bool add(int value) override { return shard(value).add(value); }
+    bool find(int value) override { return shard(value).find(value); }
+    bool remove(int value) override { return shard(value).remove(value); }
+
+private:
+    // Cache-line aligned so neighbouring shard locks do not false-share
+    struct alignas(64) Shard : SharedMutexTree<TreeType>
+    {
+    };
+
+    std::vector<Shard> shards;
+
+    Shard &shard(int value)
+    {
+        // Fibonacci hashing spreads runs of consecutive keys over all shards
+        return shards[(static_cast<std::uint32_t>(value) * 2654435769u >> 16) % shards.size()];
+    }
+};
+
+/**
+ * @brief Trees that synchronise themselves (ConcurrentBTree, ConcurrentRBTree) - called directly, no lock around them.
+ */
+template <typename TreeType>
+class SelfSynchronizedTree : public IConcurrentTree
+{
+public:
+    bool add(int value) override { return tree.add(value); }
+    bool find(int value) override { return tree.find(value); }
+    bool remove(int value) override { return tree.remove(value); }
+
+private:
+    TreeType tree;
+};
+
+/**
+ * @brief Aggregate ops/sec of one locked tree driven by `threads` workers.
+ * The tree is prefilled with every even key so finds hit about half the time, and writes alternate
+ * between add and remove to keep its size steady. Each worker's operation stream is generated up front
+ * (fixed seed per thread) so the timed region contains nothing but tree calls.
+ */
+double measure_concurrent(IConcurrentTree &tree, const ConcurrentConfig &config, int threads)
+{
+    enum class Op : std::uint8_t
+    {
+        FIND,
+        ADD,
+        REMOVE
+    };
+
+    for (int key = 0; key < config.elements; key += 2)
+        tree.add(key);
+
+    std::vector<std::vector<std::pair<Op, int>>> streams(threads);
+    for (int t = 0; t < threads; ++t)
+    {
+        std::mt19937 gen(1337 + t);
+        std::uniform_int_distribution<int> key_dist(0, config.elements - 1), mix_dist(0, 99);
+        streams[t].reserve(config.ops_per_thread);
+        for (std::size_t i = 0; i < config.ops_per_thread; ++i)
+        {
+            Op op = mix_dist(gen) < config.read_percent ? Op::FIND : (gen() & 1 ? Op::ADD : Op::REMOVE);
+            streams[t].emplace_back(op, key_dist(gen));
+        }
+    }
+
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<std::size_t> hits{0};
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]
+        {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            std::size_t local_hits = 0;
+            for (auto [op, key] : streams[t])
+            {
+                switch (op)
+                {
+                case Op::FIND:
+                    local_hits += tree.find(key);
+                    break;
+                case Op::ADD:
+                    local_hits += tree.add(key);
+                    break;
+                case Op::REMOVE:
+                    local_hits += tree.remove(key);
+                    break;
+                }
+            }
+            hits.fetch_add(local_hits);
+        });
+
+    while (ready.load() < threads)
+        std::this_thread::yield();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &worker : workers)
+        worker.join();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsed = end - start;
+    return threads * config.ops_per_thread / elapsed.count();
+}
+
+/**
+ * @brief Scaling table - one row per tree and locking scheme, one column per thread count.
+ * Each cell is aggregate Mops/s with the speed-up over the first thread count in brackets.
+ */
+void run_concurrent_benchmark(const ConcurrentConfig &config)
+{
+    std::string header = "| Tree / Lock                |";
+    for (int threads : config.thread_counts)
+    {
+        std::string label = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        header += " " + std::string(16 - label.size(), ' ') + label + " |";
+    }
+
+    std::cout << "\n--- Concurrent Throughput (" << config.read_percent << "% reads, " << config.ops_per_thread
+              << " ops/thread, " << config.elements / 2 << " keys, " << std::thread::hardware_concurrency() << " hardware threads) ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    auto row = [&](const std::string &name, const std::string &lock, auto make)
+    {
+        std::cout << "| " << std::left << std::setw(27) << name + " / " + lock << "|" << std::flush;
+        double base = 0;
+        for (int threads : config.thread_counts)
+        {
+            std::unique_ptr<IConcurrentTree> tree = make();
+            double rate = measure_concurrent(*tree, config, threads);
+            if (base == 0)
+                base = rate;
+            std::cout << " " << std::right << std::setw(7) << std::fixed << std::setprecision(2) << rate / 1e6
+                      << " (" << std::setw(5) << std::setprecision(2) << rate / base << "x) |" << std::flush;
+            report.add("concurrent", name + " / " + lock, "threads=" + std::to_string(threads), "Mops/s", rate / 1e6);
+        }
+        std::cout << "\n";
+    };
+
+    auto run_tree = [&]<typename TreeType>(const std::string &name)
+    {
+        row(name, "mutex", [] { return std::make_unique<MutexTree<TreeType>>(); });
+        row(name, SharedMutexTree<TreeType>::shared_reads ? "rwlock" : "rwlock (excl)", [] { return std::make_unique<SharedMutexTree<TreeType>>(); });
+        row(name, "sharded x" + std::to_string(config.shards), [&] { return std::make_unique<ShardedTree<TreeType>>(config.shards); });
+    };
+
+    run_tree.operator()<AVLTree<int>>("AVL Tree");
+    run_tree.operator()<RBTree<int>>("RB Tree");
+    run_tree.operator()<SplayTree<int>>("Splay Tree");
+    run_tree.operator()<BTree<int, B_TREE_ORDER>>("B-Tree");
+    run_tree.operator()<BPlusTree<int, B_TREE_ORDER>>("B+Tree");
+    row("B-Tree", "optimistic", [] { return std::make_unique<SelfSynchronizedTree<ConcurrentBTree<int, B_TREE_ORDER>>>(); });
+    row("RB Tree", "epoch (RCU)", [] { return std::make_unique<SelfSynchronizedTree<ConcurrentRBTree<int>>>(); });
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+// =================================================================================================
+// 4. SIZE AND ORDER SWEEP
+//
+// Every structure, with B-Trees and B+Trees at each compiled order, timed per operation across element
+// counts and key types - for finding where one layout overtakes another as the working set moves from
+// L1 to L2, LLC and DRAM.
+// =================================================================================================
+
+// Sweep keys built from a distinct int - order-preserving for the numeric types
+template <typename Key>
+Key make_key(int i)
+{
+    if constexpr (std::is_same_v<Key, std::string>)
+    {
+        std::string digits = std::to_string(i);
+        return "key:" + std::string(16 - digits.size(), '0') + digits;
+    }
+    else
+        return static_cast<Key>(i);
+}
+
+template <typename Key>
+std::string key_name()
+{
+    if constexpr (std::is_same_v<Key, std::string>)
+        return "string (20 chars)";
+    else
+        return std::to_string(sizeof(Key) * 8) + "-bit int";
+}
+
+/**
+ * @brief Average ns per insert, find hit, find miss and remove for one structure. Small sizes repeat the
+ * whole build/probe/teardown cycle until about a million operations have run, so each row is stable.
+ */
+template <typename Tree, typename Key>
+void sweep_row(const std::string &name, const std::vector<Key> &keys, const std::vector<Key> &miss_keys, const std::vector<Key> &remove_keys)
+{
+    const std::string suite = "sweep:" + key_name<Key>();
+    using clock = std::chrono::high_resolution_clock;
+    const std::size_t rounds = std::max<std::size_t>(1, 1'000'000 / keys.size());
+    std::chrono::duration<double, std::nano> insert_time{}, hit_time{}, miss_time{}, remove_time{};
+    std::size_t successes = 0;
+
+    for (std::size_t r = 0; r < rounds; ++r)
+    {
+        Tree tree;
+        auto t0 = clock::now();
+        for (const Key &key : keys)
+            successes += tree.add(key);
+        auto t1 = clock::now();
+        for (const Key &key : keys)
+            successes += tree.find(key);
+        auto t2 = clock::now();
+        for (const Key &key : miss_keys)
+            successes += tree.find(key);
+        auto t3 = clock::now();
+        for (const Key &key : remove_keys)
+            successes += tree.remove(key);
+        auto t4 = clock::now();
+
+        insert_time += t1 - t0;
+        hit_time += t2 - t1;
+        miss_time += t3 - t2;
+        remove_time += t4 - t3;
+    }
+
+    if (successes != rounds * 3 * keys.size())
+        std::cerr << name << ": unexpected result count\n";
+
+    const double ops = static_cast<double>(rounds * keys.size());
+    std::cout << "| " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+              << "| " << std::setw(9) << insert_time.count() / ops << " "
+              << "| " << std::setw(9) << hit_time.count() / ops << " "
+              << "| " << std::setw(9) << miss_time.count() / ops << " "
+              << "| " << std::setw(9) << remove_time.count() / ops << " |" << std::endl;
+    report.add(suite, name, "insert", "ns", insert_time.count() / ops);
+    report.add(suite, name, "find_hit", "ns", hit_time.count() / ops);
+    report.add(suite, name, "find_miss", "ns", miss_time.count() / ops);
+    report.add(suite, name, "remove", "ns", remove_time.count() / ops);
+}
+
+template <typename Key, std::size_t... Orders>
+void run_sweep(int elements, const std::vector<std::size_t> &orders, std::index_sequence<Orders...>)
+{
+    std::mt19937 gen(1337);
+    std::vector<Key> keys, miss_keys, remove_keys;
+    for (int i = 0; i < elements; ++i)
+    {
+        keys.push_back(make_key<Key>(2 * i));
+        miss_keys.push_back(make_key<Key>(2 * i + 1));
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+    std::shuffle(miss_keys.begin(), miss_keys.end(), gen);
+    remove_keys = keys;
+    std::shuffle(remove_keys.begin(), remove_keys.end(), gen);
+
+    const std::string header = "| Structure       | Insert ns | Find hit  | Find miss | Remove ns |";
+    std::cout << "\n--- Sweep: " << elements << " keys, " << key_name<Key>() << " ---\n";
+    std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+    sweep_row<AVLTree<Key>>("AVL Tree", keys, miss_keys, remove_keys);
+    sweep_row<RBTree<Key>>("RB Tree", keys, miss_keys, remove_keys);
+    sweep_row<SplayTree<Key>>("Splay Tree", keys, miss_keys, remove_keys);
+
+    auto b_trees = [&]<std::size_t N>()
+    {
+        if (std::ranges::find(orders, N) == orders.end())
+            return;
+        sweep_row<BTree<Key, N>>("B-Tree N=" + std::to_string(N), keys, miss_keys, remove_keys);
+        sweep_row<BPlusTree<Key, N>>("B+Tree N=" + std::to_string(N), keys, miss_keys, remove_keys);
+    };
+    (b_trees.template operator()<Orders>(), ...);
+
+    sweep_row<SetTree<Key>>("std::set", keys, miss_keys, remove_keys);
+    std::cout << std::string(header.size(), '-') << "\n";
+}
+
+template <std::size_t... Orders>
+std::vector<std::size_t> compiled_orders(std::index_sequence<Orders...>)
+{
+    return {Orders...};
+}
+
+// =================================================================================================
+// 5. MAIN EXECUTION
+// =================================================================================================
+
+struct Options
+{
+    bool concurrent_mode = false;
+    bool workload_mode = false;
+    bool sweep_mode = false;
+    bool perf = false;
+    bool stats = false;
+    std::uint64_t seed = 42;
+    int repeat = 1;
+    std::string csv_path, json_path;
+    std::vector<std::string> compare_paths;
+    double alpha = 0.05, threshold = 0.02;
+    std::vector<int> sizes;
+    std::string key_type = "int";
+    std::vector<std::size_t> orders;
+    ConcurrentConfig concurrent;
+};
+
+/**
+ * @brief Command line: no arguments runs the single-threaded suite; `--perf` adds hardware counters to it
+ * and `--stats` the trees' own comparison, visit and restructuring counts.
+ * `--sizes=1e3,1e5` runs any mode once per element count.
+ * `--workloads` runs only the skewed workload table, `--seed=<n>` reseeds its generators.
+ * `--sweep` times every structure per operation, with `--key=int|int64|string` and `--orders=4,16,64`
+ * choosing from the B-Tree orders compiled into `SweepOrders`.
+ * `--concurrent` runs the locked scaling benchmark instead, tuned with `--threads=1,2,4`, `--reads=<percent>`,
+ * `--ops=<per thread>` and `--shards=<count>`.
+ * `--repeat=<n>` runs the chosen mode n times; `--csv=<path>` / `--json=<path>` save every measurement with the
+ * environment. `--compare=<base.csv>,<new.csv>` only compares two saved runs, flagging changes worse than
+ * `--threshold=<percent>` (default 2) that Welch's t-test finds significant at `--alpha=<p>` (default 0.05).
+ * Measurements with fewer than two repetitions on a side cannot be tested and are listed as untested.
+ */
+bool parse_args(int argc, char **argv, Options &options)
+{
+    ConcurrentConfig &concurrent = options.concurrent;
+    auto value = [](std::string_view arg, std::string_view flag) { return std::string(arg.substr(flag.size())); };
+
+    // Comma separated list; counts may use exponent notation such as 1e6
+    auto numbers = [](const std::string &list)
+    {
+        std::vector<double> parsed;
+        for (std::size_t pos = 0; pos < list.size();)
+        {
+            std::size_t comma = std::min(list.find(',', pos), list.size());
+            parsed.push_back(std::stod(list.substr(pos, comma - pos)));
+            pos = comma + 1;
+        }
+        return parsed;
+    };
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string_view arg = argv[i];
+            if (arg == "--concurrent")
+                options.concurrent_mode = true;
+            else if (arg == "--perf")
+                options.perf = true;
+            else if (arg == "--stats")
+                options.stats = true;
+            else if (arg == "--workloads")
+                options.workload_mode = true;
+            else if (arg == "--sweep")
+                options.sweep_mode = true;
+            else if (arg.starts_with("--seed="))
+                options.seed = std::stoull(value(arg, "--seed="));
+            else if (arg.starts_with("--repeat="))
+                options.repeat = std::stoi(value(arg, "--repeat="));
+            else if (arg.starts_with("--csv="))
+                options.csv_path = value(arg, "--csv=");
+            else if (arg.starts_with("--json="))
+                options.json_path = value(arg, "--json=");
+            else if (arg.starts_with("--compare="))
+            {
+                std::string paths = value(arg, "--compare=");
+                std::size_t comma = paths.find(',');
+                if (comma == std::string::npos)
+                    return false;
+                options.compare_paths = {paths.substr(0, comma), paths.substr(comma + 1)};
+            }
+            else if (arg.starts_with("--alpha="))
+                options.alpha = std::stod(value(arg, "--alpha="));
+            else if (arg.starts_with("--threshold="))
+                options.threshold = std::stod(value(arg, "--threshold=")) / 100;
+            else if (arg.starts_with("--sizes="))
+            {
+                for (double size : numbers(value(arg, "--sizes=")))
+                {
+                    if (size < 1 || size > std::numeric_limits<int>::max() / 5)
+                        return false;
+                    options.sizes.push_back(static_cast<int>(size));
+                }
+            }
+            else if (arg.starts_with("--key="))
+                options.key_type = value(arg, "--key=");
+            else if (arg.starts_with("--orders="))
+            {
+                for (double order : numbers(value(arg, "--orders=")))
+                    options.orders.push_back(static_cast<std::size_t>(order));
+            }
+            else if (arg.starts_with("--threads="))
+            {
+                for (double threads : numbers(value(arg, "--threads=")))
+                    concurrent.thread_counts.push_back(static_cast<int>(threads));
+            }
+            else if (arg.starts_with("--reads="))
+                concurrent.read_percent = std::stoi(value(arg, "--reads="));
+            else if (arg.starts_with("--ops="))
+                concurrent.ops_per_thread = std::stoul(value(arg, "--ops="));
+            else if (arg.starts_with("--shards="))
+                concurrent.shards = std::stoul(value(arg, "--shards="));
+            else
+                return false;
+        }
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+
+    // The sweep spans L1-sized to DRAM-sized working sets unless told otherwise
+    if (options.sizes.empty())
+        options.sizes = options.sweep_mode ? std::vector<int>{1'000, 10'000, 100'000, 1'000'000} : std::vector<int>{DEFAULT_ELEMENTS};
+
+    std::vector<std::size_t> compiled = compiled_orders(SweepOrders{});
+    if (options.orders.empty())
+        options.orders = compiled;
+    for (std::size_t order : options.orders)
+        if (std::ranges::find(compiled, order) == compiled.end())
+        {
+            std::cerr << "B-Tree order " << order << " is not compiled into SweepOrders\n";
+            return false;
+        }
+
+    if (options.key_type != "int" && options.key_type != "int64" && options.key_type != "string")
+        return false;
+
+    if (concurrent.thread_counts.empty())
+        for (int threads = 1; threads <= static_cast<int>(std::max(4u, std::thread::hardware_concurrency())); threads *= 2)
+            concurrent.thread_counts.push_back(threads);
+
+    bool valid_threads = std::ranges::all_of(concurrent.thread_counts, [](int threads) { return threads > 0; });
+    return valid_threads && concurrent.read_percent >= 0 && concurrent.read_percent <= 100 && concurrent.shards > 0 && options.repeat > 0;
+}
+
+/**
+ * @brief The single-threaded suite (or just the workload table) at one element count.
+ */
+void run_suite(const Options &options, int elements, PerfCounters *perf)
+{
+    // --- Data Preparation ---
+    std::vector<int> random_data(elements);
+    std::vector<int> sorted_data(elements);
+    std::vector<int> search_miss_data(elements);
+
+    std::mt19937 gen(1337); // Fixed seed for reproducibility
+    std::uniform_int_distribution<> distrib(0, elements * 5);
+
+    for (int i = 0; i < elements; ++i)
+    {
+        sorted_data[i] = i;
+        random_data[i] = i;
+        search_miss_data[i] = distrib(gen); // Values likely not in the trees
+    }
+    std::shuffle(random_data.begin(), random_data.end(), gen);
+    std::vector<int> random_delete_data = random_data;
+    std::shuffle(random_delete_data.begin(), random_delete_data.end(), gen);
+
+    // --- Tree Instantiation ---
+    std::vector<std::unique_ptr<IBenchmarkableTree>> trees;
+    trees.push_back(std::make_unique<CppTreeWrapper<AVLTree<int>>>("AVL Tree"));
+    trees.push_back(std::make_unique<CppTreeWrapper<RBTree<int>>>("RB Tree"));
+    trees.push_back(std::make_unique<CppTreeWrapper<SplayTree<int>>>("Splay Tree"));
+    trees.push_back(std::make_unique<CppTreeWrapper<SplayTree<int, std::less<int>, NodePool<int>, NoStats, TopDownSplay>>>("Splay top-down"));
+    trees.push_back(std::make_unique<CppTreeWrapper<BTree<int, B_TREE_ORDER>>>(
+        "B-Tree (N=" + std::to_string(B_TREE_ORDER) + ")"));
+    trees.push_back(std::make_unique<CppTreeWrapper<BTree<int, B_TREE_ORDER, ScalarLess>>>("B-Tree (scalar)"));
+    trees.push_back(std::make_unique<CppTreeWrapper<BPlusTree<int, B_TREE_ORDER>>>(
+        "B+Tree (N=" + std::to_string(B_TREE_ORDER) + ")"));
+
+    // --- Run Benchmarks ---
+    auto run_test_set = [&](const std::string &suite, const std::string &test_name, const std::vector<int> &data_set)
+    {
+        auto record = [&](const std::string &name, const BenchmarkResults &results)
+        {
+            report.add(suite, name, "insert", "ms", results.insert_time.count());
+            report.add(suite, name, "find_hit", "ms", results.find_hit_time.count());
+            report.add(suite, name, "find_miss", "ms", results.find_miss_time.count());
+            report.add(suite, name, "remove", "ms", results.remove_time.count());
+            report.add(suite, name, "memory", "bytes/key", results.memory.bytes_per_key());
+            report.add(suite, name, "fill", "fill", results.memory.fill);
+        };
+
+        std::cout << "\n--- Benchmarking on " << test_name << " (" << elements << " elements) ---\n";
+        const std::string header = "| Tree Type       |        Insert |    Find (Hit) |   Find (Miss) |        Remove | Bytes/key |  Fill |";
+        std::cout << std::string(header.size(), '-') << "\n" << header << "\n" << std::string(header.size(), '-') << "\n";
+
+        std::vector<std::pair<std::string, BenchmarkResults>> rows;
+        for (const auto &tree : trees)
+        {
+            BenchmarkResults results;
+            run_benchmark(*tree, data_set, search_miss_data, results, perf);
+            print_results(tree->name(), results);
+            record(tree->name(), results);
+            rows.emplace_back(tree->name(), results);
+        }
+
+        BenchmarkResults results;
+        run_benchmark(data_set, search_miss_data, results, perf);
+        print_results("std::set", results);
+        record("std::set", results);
+        rows.emplace_back("std::set", results);
+        std::cout << std::string(header.size(), '-') << "\n";
+
+        if (perf)
+            print_counters(suite, rows, data_set.size(), search_miss_data.size());
+    };
+
+    if (options.workload_mode)
+    {
+        run_workload_benchmark(trees, elements, options.seed);
+        run_splay_policy_benchmark(elements, options.seed);
+        run_cache_benchmark(elements, options.seed);
+        return;
+    }
+
+    run_test_set("random", "Randomly Ordered Data", random_data);
+    run_test_set("sequential", "Sequentially Ordered Data", sorted_data);
+    if (options.stats)
+        run_structure_stats(random_data, search_miss_data);
+    run_latency_report(trees, random_data, search_miss_data);
+    run_workload_benchmark(trees, elements, options.seed);
+    run_splay_policy_benchmark(elements, options.seed);
+    run_cache_benchmark(elements, options.seed);
+    run_batch_benchmark(trees, random_data);
+    run_interleaved_benchmark(random_data);
+    run_scan_benchmark(random_data);
+    run_finger_benchmark(sorted_data);
+    run_bulk_load_benchmark(sorted_data);
+    run_allocator_benchmark(random_data);
+    run_string_key_benchmark(random_data);
+    run_layout_benchmark(random_data);
+    report_btree_memory(random_data);
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_args(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0] << " [--sizes=1e3,1e5] [--perf] [--stats] [--workloads] [--seed=42] [--repeat=1] [--csv=out.csv] [--json=out.json]\n"
+                  << "       [--sweep [--key=int|int64|string] [--orders=4,16,64]]\n"
+                  << "       [--concurrent [--threads=1,2,4] [--reads=90] [--ops=200000] [--shards=16]]\n"
+                  << "       " << argv[0] << " --compare=base.csv,new.csv [--alpha=0.05] [--threshold=2]\n";
+        return 1;
+    }
+
+    if (!options.compare_paths.empty())
+    {
+        int regressions = compare_reports(options.compare_paths[0], options.compare_paths[1], options.alpha, options.threshold);
+        return regressions == 0 ? 0 : 1;
+    }
+
+    record_environment(report);
+    report.set("seed", std::to_string(options.seed));
+    report.set("repetitions", std::to_string(options.repeat));
+    report.set("arguments", [&]
+    {
+        std::string joined;
+        for (int i = 1; i < argc; ++i)
+            joined += (i > 1 ? " " : "") + std::string(argv[i]);
+        return joined;
+    }());
+
+    std::unique_ptr<PerfCounters> perf;
+    if (options.perf && !options.concurrent_mode && !options.sweep_mode)
+    {
+        perf = std::make_unique<PerfCounters>();
+        if (!perf->available())
+        {
+            std::cout << "Hardware counters unavailable (" << perf->error() << "); continuing with timings only\n";
+            perf.reset();
+        }
+    }
+
+    for (int repetition = 0; repetition < options.repeat; ++repetition)
+    {
+        report.repetition = repetition;
+        if (options.repeat > 1)
+            std::cout << "\n=== Repetition " << repetition + 1 << " of " << options.repeat << " ===\n";
+
+        for (int elements : options.sizes)
+        {
+            report.size = elements;
+            if (options.concurrent_mode)
+            {
+                options.concurrent.elements = elements;
+                run_concurrent_benchmark(options.concurrent);
+            }
+            else if (options.sweep_mode)
+            {
+                if (options.key_type == "int")
+                    run_sweep<int>(elements, options.orders, SweepOrders{});
+                else if (options.key_type == "int64")
+                    run_sweep<std::int64_t>(elements, options.orders, SweepOrders{});
+                else
+                    run_sweep<std::string>(elements, options.orders, SweepOrders{});
+            }
+            else
+                run_suite(options, elements, perf.get());
+        }
+    }
+
+    if (!options.csv_path.empty() && !report.write_csv(options.csv_path))
+    {
+        std::cerr << "cannot write " << options.csv_path << "\n";
+        return 1;
+    }
+    if (!options.json_path.empty() && !report.write_json(options.json_path))
+    {
+        std::cerr << "cannot write " << options.json_path << "\n";
+        return 1;
+    }
 
     return 0;
 }